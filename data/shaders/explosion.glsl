@@ -0,0 +1,8 @@
+// explosions as GPU particles, see Explosion in Game.hh
+// emitters live in a ring buffer, explosion.csh collects the live ones once per frame
+
+#define MAX_EXPLOSIONS 1024 // same as in Game.hh
+#define EXPLOSION_TIME 0.3  // seconds
+#define EXPLOSION_PARTS 8   // the mesh changes over time
+#define EXPLOSION_PART_VERTICES 60
+#define EXPLOSION_RADIUS 1.0
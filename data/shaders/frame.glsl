@@ -0,0 +1,47 @@
+// per-frame and per-view data, see FrameData/ViewData in Game.hh
+// filled once per frame (and once per view) in Game::render
+
+#define MAX_MODE_AREAS 16 // same as in Game.hh
+
+layout(std140) uniform FrameBlock
+{
+    mat4 uShadowViewProj;     // whole arena
+    mat4 uShadowViewProjNear; // fitted to the camera near range
+    vec3 uLightPos;
+    float uTime;
+    float uSkyFactor;
+    float uTexShadowSize;
+    int uModeAreaCount;
+    int uLightCount; // see lights.glsl
+    vec4 uModeAreas[MAX_MODE_AREAS];          // xyz pos, w radius
+    ivec4 uModeAreaModes[MAX_MODE_AREAS / 4]; // mode of area i at [i / 4][i % 4]
+    mat4 uCamViewProj;     // camera without the TAA jitter
+    mat4 uPrevCamViewProj; // same for the last frame, for the velocity buffer
+};
+
+layout(std140) uniform ViewBlock
+{
+    mat4 uProj;
+    mat4 uView;
+    mat4 uInvProj;
+    mat4 uInvView;
+    vec3 uCamPos;
+    float uZNear;
+    float uZFar;
+};
+
+// mode (see Mode in Game.hh) of the area i
+int modeAreaMode(int i)
+{
+    return uModeAreaModes[i / 4][i % 4];
+}
+
+// where areas overlap the highest mode wins
+int modeAt(vec3 worldPos)
+{
+    int mode = 0;
+    for (int i = 0; i < uModeAreaCount; ++i)
+        if (distance(uModeAreas[i].xyz, worldPos) < uModeAreas[i].w)
+            mode = max(mode, modeAreaMode(i));
+    return mode;
+}
@@ -0,0 +1,14 @@
+// screen tiles sorted by the modes they contain
+// classify.csh appends each tile to the list of its class, fuse.vsh draws one quad per listed tile
+
+#define FUSE_TILE 16   // same as in Game.hh
+#define FUSE_CLASSES 5 // same as in Game.hh
+#define FUSE_MIXED 4   // class of tiles with more than one mode, classes 0-3 are the single modes
+
+// FUSE_CLASSES lists of uTileCapacity tiles each, x | y << 16
+layout(std430) buffer FuseTileBuffer
+{
+    uint fuseTiles[];
+};
+
+uniform int uTileCapacity;
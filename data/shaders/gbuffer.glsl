@@ -0,0 +1,28 @@
+// G-buffer encoding, see the GBuffer targets in Game::init
+// albedo: sRGB8 (written with GL_FRAMEBUFFER_SRGB), material: RG8 metallic/roughness,
+// normal: RG16 octahedral, (0, 0) means no normal was written
+// velocity: RG16F screen space motion since the last frame in uv units, for taa.fsh
+
+vec2 encodeNormal(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.z >= 0 ? n.xy : (1 - abs(n.yx)) * vec2(n.x >= 0 ? 1 : -1, n.y >= 0 ? 1 : -1);
+    return max(e * .5 + .5, vec2(1. / 65535)); // keep (0, 0) free
+}
+
+vec3 decodeNormal(vec2 e)
+{
+    if (e == vec2(0))
+        return vec3(0); // cleared, e.g. sky
+    e = e * 2 - 1;
+    vec3 n = vec3(e, 1 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0);
+    n.xy += vec2(n.x >= 0 ? -t : t, n.y >= 0 ? -t : t);
+    return normalize(n);
+}
+
+// clip positions with uCamViewProj and uPrevCamViewProj
+vec2 encodeVelocity(vec4 clipPos, vec4 prevClipPos)
+{
+    return (clipPos.xy / clipPos.w - prevClipPos.xy / prevClipPos.w) * .5;
+}
@@ -0,0 +1,73 @@
+// compact per-instance data, see CubeInstance/RocketInstance in Game.cc
+// the model matrix is rebuilt here instead of uploading a mat4 per instance
+// needs frame.glsl for the drawn areas
+
+mat3 quatToMat3(vec4 q)
+{
+    vec3 q2 = q.xyz * 2;
+    float xx = q.x * q2.x, yy = q.y * q2.y, zz = q.z * q2.z;
+    float xy = q.x * q2.y, xz = q.x * q2.z, yz = q.y * q2.z;
+    float wx = q.w * q2.x, wy = q.w * q2.y, wz = q.w * q2.z;
+    return mat3(1 - yy - zz, xy + wz, xz - wy, //
+                xy - wz, 1 - xx - zz, yz + wx, //
+                xz + wy, yz - wx, 1 - xx - yy);
+}
+
+mat3 rotateY(float a)
+{
+    float c = cos(a), s = sin(a);
+    return mat3(c, 0, -s, 0, 1, 0, s, 0, c);
+}
+
+// axis angle, like glm::rotate
+mat3 rotateAxis(vec3 axis, float a)
+{
+    float c = cos(a), s = sin(a);
+    vec3 t = (1 - c) * axis;
+    return mat3(t.x * axis + vec3(c, s * axis.z, -s * axis.y), //
+                t.y * axis + vec3(-s * axis.z, c, s * axis.x), //
+                t.z * axis + vec3(s * axis.y, -s * axis.x, c));
+}
+
+// rotates +z to dir, same as rotate() in conversion.hh
+mat3 rotateTo(vec3 to)
+{
+    const vec3 from = vec3(0, 0, 1);
+    float angle = acos(clamp(dot(to, from), -1, 1));
+    vec3 axis = -cross(to, from);
+    if (dot(axis, axis) < 1e-12) // couldn't get cross product
+        axis = vec3(to.x, -to.z, to.y);
+    return rotateAxis(normalize(axis), angle);
+}
+
+// cube: pos, uniform scale, rotation quaternion
+// shrinks a bit in every drawn area it is in
+mat4 cubeModel(vec4 posScale, vec4 rotation)
+{
+    float scale = posScale.w;
+    for (int i = 0; i < uModeAreaCount; ++i)
+        if (modeAreaMode(i) == 2 /* drawn */ && distance(uModeAreas[i].xyz, posScale.xyz) < uModeAreas[i].w)
+            scale *= 0.95;
+
+    mat4 m = mat4(quatToMat3(rotation) * scale);
+    m[3] = vec4(posScale.xyz, 1);
+    return m;
+}
+
+// rocket: pos, type (see rtype), velocity, spin around y
+// homing rockets send their rotation quaternion instead of velocity and spin
+mat4 rocketModel(vec4 posType, vec4 velSpin)
+{
+    int type = int(posType.w + 0.5);
+    mat3 r = type == 1 ? quatToMat3(velSpin) : rotateY(velSpin.w);
+    if (type == 0) // forward
+        r *= 0.5;
+    if (type == 2) // falling
+        r *= mat3(1, 0, 0, 0, 0, 1, 0, -1, 0); // +z to -y
+    if (type != 1 && dot(velSpin.xyz, velSpin.xyz) > 0) // not homing
+        r *= rotateTo(normalize(velSpin.xyz));
+
+    mat4 m = mat4(r);
+    m[3] = vec4(posType.xyz, 1);
+    return m;
+}
@@ -0,0 +1,47 @@
+// clustered point lights, see Game::uploadLights
+// the screen is split in CLUSTER_TILE^2 pixel tiles and CLUSTER_SLICES exponential depth slices
+// cluster.csh fills a light index list per cluster, light.fsh only loops over that list
+
+#define CLUSTER_TILE 16   // same as in Game.hh
+#define CLUSTER_SLICES 16 // same as in Game.hh
+#define CLUSTER_MAX_LIGHTS 64
+
+struct PointLight
+{
+    vec4 posRadius; // xyz world pos, w radius
+    vec4 color;     // rgb color * intensity
+};
+
+layout(std430) buffer LightBuffer
+{
+    PointLight lights[];
+};
+
+// offset and count into clusterIndices per cluster
+layout(std430) buffer ClusterBuffer
+{
+    uvec2 clusters[];
+};
+
+layout(std430) buffer ClusterIndexBuffer
+{
+    uint clusterIndices[];
+};
+
+uniform ivec3 uClusterCount; // tiles x, tiles y, slices
+
+// needs frame.glsl
+int clusterSlice(float viewDepth)
+{
+    return clamp(int(log(viewDepth / uZNear) / log(uZFar / uZNear) * CLUSTER_SLICES), 0, CLUSTER_SLICES - 1);
+}
+
+float clusterSliceDepth(int slice)
+{
+    return uZNear * pow(uZFar / uZNear, float(slice) / CLUSTER_SLICES);
+}
+
+int clusterIndex(ivec3 cluster)
+{
+    return (cluster.z * uClusterCount.y + cluster.y) * uClusterCount.x + cluster.x;
+}
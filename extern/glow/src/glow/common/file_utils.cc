@@ -20,8 +20,15 @@ int64_t glow::util::fileModificationTime(std::string const& filename)
     return t;
 }
 
+bool glow::util::createDirectory(std::string const& dirname)
+{
+    return CreateDirectory(dirname.c_str(), NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+}
+
 #else
 
+#include <cerrno>
+
 #include <sys/stat.h>
 #include <sys/types.h>
 
@@ -35,4 +42,9 @@ int64_t glow::util::fileModificationTime(std::string const& filename)
     return attr.st_ctim.tv_sec * (int64_t)1000000000 + attr.st_ctim.tv_nsec;
 #endif
 }
+
+bool glow::util::createDirectory(std::string const& dirname)
+{
+    return mkdir(dirname.c_str(), 0755) == 0 || errno == EEXIST;
+}
 #endif
@@ -11,5 +11,9 @@ namespace util
 /// Returns 0 for non-existing file
 /// Gets bigger with progressing time
 int64_t fileModificationTime(std::string const& filename);
+
+/// Creates a directory (not its parents)
+/// Returns true if it exists afterwards
+bool createDirectory(std::string const& dirname);
 }
 }
@@ -0,0 +1,80 @@
+#include "mapped_file.hh"
+
+#ifdef _MSC_VER
+
+#include <Windows.h>
+
+std::shared_ptr<glow::util::MappedFile> glow::util::MappedFile::open(std::string const& filename)
+{
+    auto hFile = CreateFile(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    std::shared_ptr<MappedFile> f(new MappedFile());
+    f->mFile = hFile;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(hFile, &size) || size.QuadPart == 0)
+        return nullptr;
+
+    f->mMapping = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!f->mMapping)
+        return nullptr;
+
+    f->mData = (char const*)MapViewOfFile(f->mMapping, FILE_MAP_READ, 0, 0, 0);
+    if (!f->mData)
+        return nullptr;
+
+    f->mSize = (size_t)size.QuadPart;
+    return f;
+}
+
+glow::util::MappedFile::~MappedFile()
+{
+    if (mData)
+        UnmapViewOfFile(mData);
+    if (mMapping)
+        CloseHandle(mMapping);
+    if (mFile)
+        CloseHandle(mFile);
+}
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::shared_ptr<glow::util::MappedFile> glow::util::MappedFile::open(std::string const& filename)
+{
+    auto fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat attr;
+    if (fstat(fd, &attr) != 0 || attr.st_size == 0)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    // the mapping stays valid after closing
+    auto data = mmap(nullptr, attr.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return nullptr;
+
+    std::shared_ptr<MappedFile> f(new MappedFile());
+    f->mData = (char const*)data;
+    f->mSize = attr.st_size;
+    return f;
+}
+
+glow::util::MappedFile::~MappedFile()
+{
+    if (mData)
+        munmap((void*)mData, mSize);
+}
+
+#endif
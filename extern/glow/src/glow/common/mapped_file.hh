@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include <glow/common/non_copyable.hh>
+
+namespace glow
+{
+namespace util
+{
+/// A read-only memory mapping of a whole file
+/// Pages are loaded by the OS on first access, nothing is copied
+class MappedFile
+{
+    GLOW_NON_COPYABLE(MappedFile);
+
+    char const* mData = nullptr;
+    size_t mSize = 0;
+#ifdef _MSC_VER
+    void* mFile = nullptr;
+    void* mMapping = nullptr;
+#endif
+
+    MappedFile() = default;
+
+public:
+    ~MappedFile();
+
+    char const* data() const { return mData; }
+    size_t size() const { return mSize; }
+
+    /// Returns nullptr if the file cannot be opened or is empty
+    static std::shared_ptr<MappedFile> open(std::string const& filename);
+};
+}
+}
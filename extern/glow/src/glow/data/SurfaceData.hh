@@ -6,6 +6,7 @@
 
 #include <glow/gl.hh>
 
+#include <memory>
 #include <vector>
 
 namespace glow
@@ -42,6 +43,15 @@ private:
 
     std::vector<char> mData;
 
+    /// true if the data are compressed blocks, mFormat is the compressed internal format then and mType is unused
+    bool mCompressed = false;
+
+    /// Data owned by someone else (e.g. a mapped file), used instead of mData if set
+    std::shared_ptr<const void> mExternalOwner;
+    char const* mExternalData = nullptr; ///< may be null, e.g. offset 0 into a bound pixel unpack buffer
+    size_t mExternalSize = 0;
+    bool mHasExternalData = false;
+
 public: // getter, setter
     GLOW_PROPERTY(Width);
     GLOW_PROPERTY(Height);
@@ -61,6 +71,22 @@ public: // getter, setter
 
     GLOW_PROPERTY(Data);
 
+    GLOW_PROPERTY_IS(Compressed);
+
+    /// The data to upload, external if set, otherwise mData
+    char const* getDataPtr() const { return mHasExternalData ? mExternalData : mData.data(); }
+    size_t getDataSize() const { return mHasExternalData ? mExternalSize : mData.size(); }
+
+    /// Uses data owned by "owner" instead of a copy in mData, no copy is made
+    /// getData() stays empty, so only uploading is supported for such surfaces
+    void setExternalData(std::shared_ptr<const void> owner, char const* data, size_t size)
+    {
+        mExternalOwner = std::move(owner);
+        mExternalData = data;
+        mExternalSize = size;
+        mHasExternalData = true;
+    }
+
 public:
     SurfaceData();
 
@@ -35,6 +35,10 @@ SharedTextureData TextureData::createFromFile(const std::string& filename, Color
     if (ending == ".png")
         return loadWithLodepng(filename, ending, colorSpace);
 
+    // pre-compressed
+    if (ending == ".dds")
+        return loadWithDDS(filename, ending, colorSpace);
+
     // stb
     if (ending == ".png" ||  //
         ending == ".jpg" ||  //
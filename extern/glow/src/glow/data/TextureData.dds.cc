@@ -0,0 +1,194 @@
+#include "SurfaceData.hh"
+#include "TextureData.hh"
+
+#include <glow/common/log.hh>
+#include <glow/common/mapped_file.hh>
+#include <glow/common/profiling.hh>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+using namespace glow;
+
+namespace
+{
+// see https://docs.microsoft.com/en-us/windows/win32/direct3ddds/dds-header
+struct DDSPixelFormat
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t masks[4];
+};
+
+struct DDSHeader
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t reserved1[11];
+    DDSPixelFormat pixelFormat;
+    uint32_t caps[4];
+    uint32_t reserved2;
+};
+
+struct DDSHeaderDX10
+{
+    uint32_t dxgiFormat;
+    uint32_t resourceDimension;
+    uint32_t miscFlag;
+    uint32_t arraySize;
+    uint32_t miscFlags2;
+};
+
+constexpr uint32_t fourCC(char a, char b, char c, char d) { return uint32_t(a) | uint32_t(b) << 8 | uint32_t(c) << 16 | uint32_t(d) << 24; }
+
+const uint32_t DDS_CUBEMAP = 0x200;         // caps2
+const uint32_t DDS_RESOURCE_MISC_CUBE = 0x4; // dx10 miscFlag
+}
+
+SharedTextureData TextureData::loadWithDDS(const std::string& filename, const std::string& ending, ColorSpace colorSpace)
+{
+    GLOW_ACTION();
+
+    auto file = util::MappedFile::open(filename);
+    if (!file)
+    {
+        error() << "Error loading DDS texture data from " << filename << ", cannot open file";
+        return nullptr;
+    }
+    return loadWithDDS(file->data(), file->size(), file, filename, colorSpace);
+}
+
+SharedTextureData TextureData::createFromRawDDS(char const* data, size_t size, std::shared_ptr<const void> owner, ColorSpace colorSpace)
+{
+    return loadWithDDS(data, size, std::move(owner), "memory", colorSpace);
+}
+
+SharedTextureData TextureData::loadWithDDS(
+    char const* data, size_t size, std::shared_ptr<const void> const& owner, std::string const& filename, ColorSpace colorSpace)
+{
+    if (size < 4 + sizeof(DDSHeader) || std::memcmp(data, "DDS ", 4) != 0)
+    {
+        error() << "Error loading DDS texture data from " << filename << ", not a DDS file";
+        return nullptr;
+    }
+
+    DDSHeader header;
+    std::memcpy(&header, data + 4, sizeof(header));
+    size_t offset = 4 + sizeof(header);
+
+    // block compressed formats only, the color space is part of the format
+    GLenum format = GL_INVALID_ENUM;
+    auto blockBytes = 16;
+    auto faces = 1;
+    auto layers = 1;
+    if (header.pixelFormat.fourCC == fourCC('D', 'X', '1', '0'))
+    {
+        DDSHeaderDX10 dx10;
+        if (size < offset + sizeof(dx10))
+        {
+            error() << "Error loading DDS texture data from " << filename << ", truncated header";
+            return nullptr;
+        }
+        std::memcpy(&dx10, data + offset, sizeof(dx10));
+        offset += sizeof(dx10);
+
+        switch (dx10.dxgiFormat)
+        {
+        case 71: // BC1_UNORM
+            format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+            blockBytes = 8;
+            break;
+        case 72: // BC1_UNORM_SRGB
+            format = GL_COMPRESSED_SRGB_S3TC_DXT1_EXT;
+            blockBytes = 8;
+            break;
+        case 77: // BC3_UNORM
+            format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            break;
+        case 78: // BC3_UNORM_SRGB
+            format = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+            break;
+        case 80: // BC4_UNORM
+            format = GL_COMPRESSED_RED_RGTC1;
+            blockBytes = 8;
+            break;
+        case 83: // BC5_UNORM
+            format = GL_COMPRESSED_RG_RGTC2;
+            break;
+        }
+        if (dx10.miscFlag & DDS_RESOURCE_MISC_CUBE)
+            faces = 6;
+        else
+            layers = std::max(1, (int)dx10.arraySize);
+    }
+    else if (header.pixelFormat.fourCC == fourCC('D', 'X', 'T', '1'))
+    {
+        format = colorSpace == ColorSpace::sRGB ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        blockBytes = 8;
+    }
+    else if (header.pixelFormat.fourCC == fourCC('D', 'X', 'T', '5'))
+        format = colorSpace == ColorSpace::sRGB ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    else if (header.pixelFormat.fourCC == fourCC('A', 'T', 'I', '2'))
+        format = GL_COMPRESSED_RG_RGTC2;
+
+    if (format == GL_INVALID_ENUM)
+    {
+        error() << "Error loading DDS texture data from " << filename << ", only BC1, BC3, BC4 and BC5 are supported";
+        return nullptr;
+    }
+    if (header.caps[1] & DDS_CUBEMAP)
+        faces = 6;
+
+    auto tex = std::make_shared<TextureData>();
+    tex->setWidth(header.width);
+    tex->setHeight(header.height);
+    tex->setDepth(layers);
+    tex->setTarget(faces == 6 ? GL_TEXTURE_CUBE_MAP : layers > 1 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D);
+    tex->setPreferredInternalFormat(format);
+
+    // faces (or array layers), each with its mip chain, straight from the owner's memory
+    auto levels = std::max(1, (int)header.mipMapCount);
+    for (auto face = 0; face < faces * layers; ++face)
+        for (auto level = 0; level < levels; ++level)
+        {
+            auto w = std::max(1, (int)header.width >> level);
+            auto h = std::max(1, (int)header.height >> level);
+            auto bytes = size_t((w + 3) / 4) * size_t((h + 3) / 4) * blockBytes;
+            if (offset + bytes > size)
+            {
+                error() << "Error loading DDS texture data from " << filename << ", truncated data";
+                return nullptr;
+            }
+
+            auto surface = std::make_shared<SurfaceData>();
+            surface->setExternalData(owner, data + offset, bytes);
+            surface->setCompressed(true);
+            surface->setFormat(format);
+            surface->setType(GL_INVALID_ENUM);
+            surface->setMipmapLevel(level);
+            surface->setWidth(w);
+            surface->setHeight(h);
+            if (faces == 6)
+                surface->setTarget(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face);
+            if (layers > 1)
+                surface->setOffsetZ(face); // one layer per surface
+            tex->addSurface(surface);
+
+            offset += bytes;
+        }
+
+    // high-quality default parameters:
+    tex->setAnisotropicFiltering(16.0f);
+    tex->setMagFilter(GL_LINEAR);
+    tex->setMinFilter(levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+
+    return tex;
+}
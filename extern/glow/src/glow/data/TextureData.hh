@@ -127,10 +127,9 @@ public: // serialization
     ///     * PIC
     ///     * PPM binary
     ///     * PGM binary
-    ///  * via GLI
-    ///     * KTX
-    ///     * DDS
     ///  * via internal code
+    ///     * DDS (BC1, BC3, BC4, BC5 incl. mipmaps, cube maps and arrays, memory-mapped, uploaded without decoding)
+    ///       colorSpace is only used for legacy DXT1/DXT5 files, DX10 formats know their own
     ///     * .texdata (100% read/write features)
     ///
     /// NOTE: if you want to load a normalmap, you probably want ColorSpace::Linear!
@@ -142,6 +141,10 @@ public: // serialization
     ///     * PNG
     static SharedTextureData createFromRawPng(unsigned char const* rawData, size_t rawDataSize, ColorSpace colorSpace);
 
+    /// Reads a DDS file from memory owned by "owner" (e.g. a mapped file), see "createFromFile"
+    /// The surfaces point into that memory, nothing is copied, owner is kept alive by them
+    static SharedTextureData createFromRawDDS(char const* data, size_t size, std::shared_ptr<const void> owner, ColorSpace colorSpace);
+
     /// Creates texture data for a cubemap, give 6 files
     /// See "createFromFile" for format doc
     static SharedTextureData createFromFileCube(std::string const& fpx,
@@ -198,6 +201,11 @@ private:
     /// Saves with lodepng
     static void saveWithLodepng(TextureData* data, std::string const& filename, std::string const& ending);
 
+    /// Loads block compressed DDS files
+    static SharedTextureData loadWithDDS(std::string const& filename, std::string const& ending, ColorSpace colorSpace);
+    static SharedTextureData loadWithDDS(
+        char const* data, size_t size, std::shared_ptr<const void> const& owner, std::string const& filename, ColorSpace colorSpace);
+
     /// Loads with stb
     static SharedTextureData loadWithStb(std::string const& filename, std::string const& ending, ColorSpace colorSpace);
     /// Saves with stb
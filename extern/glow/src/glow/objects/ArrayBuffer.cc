@@ -105,6 +105,38 @@ void BoundArrayBuffer::implSetData(size_t sizeInBytes, const void* data, size_t
     assert(sizeInBytes % buffer->mStride == 0 && "The size in byte doesn't match stride * elements");
 }
 
+void BoundArrayBuffer::setStorage(size_t sizeInBytes, GLbitfield flags)
+{
+    if (!isCurrent())
+        return;
+
+    checkValidGLOW();
+
+    glBufferStorage(GL_ARRAY_BUFFER, sizeInBytes, nullptr, flags);
+    buffer->mElementCount = (GLuint)sizeInBytes / buffer->mStride;
+    assert(sizeInBytes % buffer->mStride == 0 && "The size in byte doesn't match stride * elements");
+}
+
+void* BoundArrayBuffer::mapRange(size_t offset, size_t sizeInBytes, GLbitfield access)
+{
+    if (!isCurrent())
+        return nullptr;
+
+    checkValidGLOW();
+
+    return glMapBufferRange(GL_ARRAY_BUFFER, offset, sizeInBytes, access);
+}
+
+void BoundArrayBuffer::unmap()
+{
+    if (!isCurrent())
+        return;
+
+    checkValidGLOW();
+
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+}
+
 BoundArrayBuffer::BoundArrayBuffer(ArrayBuffer* buffer) : buffer(buffer)
 {
     checkValidGLOW();
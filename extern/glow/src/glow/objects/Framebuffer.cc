@@ -90,6 +90,34 @@ void Framebuffer::internalReattach()
         attachToFramebuffer(mDepthAttachment.texture, GL_DEPTH_ATTACHMENT, mDepthAttachment.mipmapLevel, mDepthAttachment.layer);
     if (mStencilAttachment.texture)
         attachToFramebuffer(mStencilAttachment.texture, GL_STENCIL_ATTACHMENT, mStencilAttachment.mipmapLevel, mStencilAttachment.layer);
+
+    // locations might have changed
+    internalSetDrawBuffers();
+}
+
+void Framebuffer::internalSetDrawBuffers()
+{
+    assert(sCurrentBuffer && sCurrentBuffer->buffer == this);
+    checkValidGLOW();
+
+    // attachments are at GL_COLOR_ATTACHMENT0 + their fragment location
+    // after negotiation with programs, these locations are not necessarily 0..n-1
+    std::vector<GLenum> drawBuffers;
+    for (auto const& a : mColorAttachments)
+    {
+        auto loc = mFragmentMapping->getOrAddLocation(a.locationName);
+        if (drawBuffers.size() <= loc)
+            drawBuffers.resize(loc + 1, GL_NONE);
+        drawBuffers[loc] = GL_COLOR_ATTACHMENT0 + loc;
+    }
+
+    // optimized: no or a single buffer
+    if (drawBuffers.empty())
+        glDrawBuffer(GL_NONE);
+    else if (drawBuffers.size() == 1)
+        glDrawBuffer(drawBuffers[0]);
+    else
+        glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
 }
 
 bool Framebuffer::internalCheckComplete()
@@ -376,22 +404,10 @@ BoundFramebuffer::BoundFramebuffer(Framebuffer* buffer) : buffer(buffer)
 
     glBindFramebuffer(GL_FRAMEBUFFER, buffer->getObjectName());
 
-    // optimized: a single buffer
-    switch (buffer->mColorAttachments.size())
-    {
-    case 0:
-        glDrawBuffer(GL_NONE);
-        break;
-    case 1:
-        glDrawBuffer(GL_COLOR_ATTACHMENT0);
-        break;
-    default:
-        GLenum drawBuffers[8] = {};
-        for (auto i = 0u; i < buffer->mColorAttachments.size(); ++i)
-            drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
-        glDrawBuffers((GLsizei)buffer->mColorAttachments.size(), drawBuffers);
-        break;
-    }
+    previousBufferPtr = sCurrentBuffer;
+    sCurrentBuffer = this; // before internalSetDrawBuffers
+
+    buffer->internalSetDrawBuffers();
 
     if (buffer->mAutoViewport)
     {
@@ -406,9 +422,6 @@ BoundFramebuffer::BoundFramebuffer(Framebuffer* buffer) : buffer(buffer)
                 dim = glm::min(dim, a.texture->getDimensions());
         glViewport(0, 0, dim.x, dim.y);
     }
-
-    previousBufferPtr = sCurrentBuffer;
-    sCurrentBuffer = this;
 }
 
 BoundFramebuffer::BoundFramebuffer(BoundFramebuffer&& rhs)
@@ -53,6 +53,9 @@ private:
     void internalReattach();
     /// Careful! must be bound
     bool internalCheckComplete();
+    /// Careful! must be bound
+    /// Enables the draw buffers of all color attachments
+    void internalSetDrawBuffers();
 
 public: // getter
     GLuint getObjectName() const { return mObjectName; }
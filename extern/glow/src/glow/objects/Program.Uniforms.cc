@@ -10,6 +10,7 @@
 #include <glow/limits.hh>
 #include <glow/util/UniformState.hh>
 
+#include <glow/common/gl_to_string.hh>
 #include <glow/common/runtime_assert.hh>
 
 using namespace glow;
@@ -67,6 +68,69 @@ void UsedProgram::setTexture(const std::string& name, const SharedTexture& tex,
     glBindSampler(unit, sampler ? sampler->getObjectName() : 0);
 }
 
+void UsedProgram::setTexture(TextureHandle& handle, const SharedTexture& tex)
+{
+    auto unit = handle.mUnit;
+    auto linkCount = handle.mLinkCount;
+    if (!updateHandle(handle.mProgram, handle.mName, tex ? tex->getUniformType() : GL_INVALID_ENUM, handle.mLocation, handle.mLinkCount))
+        return;
+
+    // ensure enough unit entries
+    while (program->mTextures.size() <= unit)
+    {
+        program->mTextures.push_back(nullptr);
+        program->mSamplers.push_back(nullptr);
+    }
+
+    if (!tex) // nullptr
+    {
+        program->mTextures[unit] = nullptr;
+        glUniform1i(handle.mLocation, limits::maxCombinedTextureImageUnits - 1);
+        handle.mLinkCount = -1; // set unit again next time
+        return;
+    }
+
+    // unit only changes with linking
+    if (linkCount != handle.mLinkCount)
+        glUniform1i(handle.mLocation, unit);
+
+    // program state is restored on use, so this is what is bound
+    if (program->mTextures[unit] == tex && !program->mSamplers[unit])
+        return;
+
+    program->mTextures[unit] = tex;
+    if (program->mSamplers[unit])
+    {
+        program->mSamplers[unit] = nullptr;
+        glBindSampler(unit, 0);
+    }
+
+    // bind texture to unit
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(tex->getTarget(), tex->getObjectName());
+
+    // safety net: activate different unit
+    glActiveTexture(GL_TEXTURE0 + limits::maxCombinedTextureImageUnits - 1);
+}
+
+bool UsedProgram::updateHandle(Program const* owner, const std::string& name, GLenum type, GLint& location, int& linkCount) const
+{
+    if (!isCurrent())
+        return false;
+
+    GLOW_RUNTIME_ASSERT(owner == program, "Handle for `" << name << "' belongs to a different program " << to_string(program), return false);
+
+    checkValidGLOW();
+
+    if (linkCount != program->mLinkCount)
+    {
+        location = program->resolveUniformLocation(name, type);
+        linkCount = program->mLinkCount;
+    }
+
+    return location >= 0;
+}
+
 void UsedProgram::setImage(int bindingLocation, const SharedTexture& tex, GLenum usage, int mipmapLevel, int layer)
 {
     GLOW_RUNTIME_ASSERT(tex->isStorageImmutable(), "Texture has to be storage immutable for image binding", return );
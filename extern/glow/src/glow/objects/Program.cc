@@ -1,8 +1,12 @@
 #include "Program.hh"
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cstring>
 #include <fstream>
+#include <iomanip>
+#include <sstream>
 
 #include "AtomicCounterBuffer.hh"
 #include "Framebuffer.hh"
@@ -13,11 +17,13 @@
 
 #include <glow/callbacks.hh>
 #include <glow/common/gl_to_string.hh>
+#include <glow/common/file_utils.hh>
 #include <glow/common/gltypeinfo.hh>
 #include <glow/common/ogl_typeinfo.hh>
 #include <glow/common/runtime_assert.hh>
 #include <glow/common/shader_endings.hh>
 #include <glow/common/str_utils.hh>
+#include <glow/common/stream_readall.hh>
 #include <glow/common/thread_local.hh>
 #include <glow/glow.hh>
 #include <glow/limits.hh>
@@ -32,6 +38,9 @@ using namespace glow;
 static GLOW_THREADLOCAL UsedProgram* sCurrentProgram = nullptr;
 
 bool Program::sCheckShaderReloading = true;
+std::string Program::sBinaryCacheDirectory;
+bool Program::sParallelCompilation = false;
+std::vector<Program*> Program::sPendingLinks;
 
 bool Program::linkAndCheckErrors()
 {
@@ -41,6 +50,13 @@ bool Program::linkAndCheckErrors()
     // link
     glLinkProgram(mObjectName);
 
+    return checkLinkErrors();
+}
+
+bool Program::checkLinkErrors()
+{
+    checkValidGLOW();
+
     // check error log
     GLint logLength = 0;
     glGetProgramiv(mObjectName, GL_INFO_LOG_LENGTH, &logLength);
@@ -122,6 +138,123 @@ void Program::setShaderReloading(bool enabled)
     sCheckShaderReloading = enabled;
 }
 
+void Program::setBinaryCacheDirectory(const std::string& dir)
+{
+    if (!dir.empty() && !util::createDirectory(dir))
+    {
+        warning() << "Unable to create program binary cache directory `" << dir << "'. Cache disabled.";
+        sBinaryCacheDirectory.clear();
+        return;
+    }
+
+    sBinaryCacheDirectory = dir;
+}
+
+void Program::beginParallelCompilation()
+{
+    checkValidGLOW();
+
+    // let the driver decide the number of threads
+    if (GLAD_GL_ARB_parallel_shader_compile)
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+
+    sParallelCompilation = true;
+    Shader::sDeferCompilation = true;
+}
+
+void Program::finishParallelCompilation()
+{
+    sParallelCompilation = false;
+    Shader::sDeferCompilation = false;
+
+    // in creation order, finishLink removes from the list
+    while (!sPendingLinks.empty())
+        sPendingLinks.front()->finishLink();
+}
+
+std::string Program::binaryCachePath() const
+{
+    std::stringstream ss;
+    ss << sBinaryCacheDirectory << "/" << std::hex << std::setw(16) << std::setfill('0') << mBinaryKey << ".bin";
+    return ss.str();
+}
+
+bool Program::loadBinary()
+{
+    checkValidGLOW();
+    mBinaryKey = 0;
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats == 0 || isConfiguredForTransformFeedback())
+        return false;
+
+    // FNV-1a over driver, sources and locations
+    uint64_t key = 14695981039346656037ull;
+    auto hash = [&key](void const* data, size_t size) {
+        for (auto i = 0u; i < size; ++i)
+        {
+            key ^= ((uint8_t const*)data)[i];
+            key *= 1099511628211ull;
+        }
+    };
+    for (auto name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+    {
+        auto s = (char const*)glGetString(name);
+        if (s)
+            hash(s, std::strlen(s));
+    }
+    for (auto const& s : mShader)
+    {
+        auto type = s->getType();
+        auto sourceHash = s->getSourceHash();
+        hash(&type, sizeof(type));
+        hash(&sourceHash, sizeof(sourceHash));
+    }
+    for (auto const& mapping : {mAttributeMapping->getMap(), mFragmentMapping->getMap()})
+        for (auto const& m : mapping)
+        {
+            hash(m.first.data(), m.first.size());
+            hash(&m.second, sizeof(m.second));
+        }
+    mBinaryKey = key;
+
+    std::ifstream file(binaryCachePath(), std::ios::binary);
+    GLenum format;
+    if (!file.read((char*)&format, sizeof(format)))
+        return false;
+    auto binary = util::readall(file);
+
+    glProgramBinary(mObjectName, format, binary.data(), (GLsizei)binary.size());
+
+    // rejected e.g. after a driver update, compiled and stored again
+    GLint linkStatus = GL_FALSE;
+    glGetProgramiv(mObjectName, GL_LINK_STATUS, &linkStatus);
+    return linkStatus == GL_TRUE;
+}
+
+void Program::saveBinary()
+{
+    checkValidGLOW();
+    if (mBinaryKey == 0)
+        return;
+
+    GLint length = 0;
+    glGetProgramiv(mObjectName, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum format;
+    glGetProgramBinary(mObjectName, length, nullptr, &format, binary.data());
+
+    std::ofstream file(binaryCachePath(), std::ios::binary);
+    file.write((char const*)&format, sizeof(format));
+    file.write(binary.data(), binary.size());
+    if (!file.good())
+        warning() << "Unable to write program binary " << binaryCachePath() << ". " << to_string(this);
+}
+
 void Program::validateTextureMipmaps() const
 {
     for (auto const& t : mTextures)
@@ -169,6 +302,27 @@ GLint Program::useUniformLocationAndVerify(const std::string& name, GLint size,
     return -1;
 }
 
+GLint Program::resolveUniformLocation(const std::string& name, GLenum type)
+{
+    auto info = getUniformInfo(name);
+
+    if (info)
+    {
+        if (type != GL_INVALID_ENUM && info->type != type)
+            warning() << "Uniform `" << name << "' has type `" << glUniformTypeToString(info->type) << "' in shader but its handle is `"
+                      << glUniformTypeToString(type) << "' in GLOW. " << to_string(this);
+        info->wasSet = true;
+        return info->location;
+    }
+
+    return -1;
+}
+
+TextureHandle Program::texture(const std::string& name)
+{
+    return TextureHandle(this, name, mTextureUnitMapping.getOrAddLocation(name));
+}
+
 GLuint Program::getUniformBlockIndex(const std::string& name) const
 {
     checkValidGLOW();
@@ -187,6 +341,8 @@ Program::Program()
 Program::~Program()
 {
     checkValidGLOW();
+    if (mLinkPending)
+        sPendingLinks.erase(std::remove(sPendingLinks.begin(), sPendingLinks.end(), this), sPendingLinks.end());
     glDeleteProgram(mObjectName);
 }
 
@@ -240,41 +396,91 @@ void Program::attachShader(const SharedShader& shader)
     glAttachShader(mObjectName, shader->getObjectName());
 }
 
+void Program::bindLocations()
+{
+    // set attribute locations
+    for (auto const& mapping : mAttributeMapping->getMap())
+        glBindAttribLocation(mObjectName, mapping.second, mapping.first.c_str());
+
+    // set fragment locations
+    for (auto const& mapping : mFragmentMapping->getMap())
+        glBindFragDataLocation(mObjectName, mapping.second, mapping.first.c_str());
+
+    // set transform feedback
+    if (isConfiguredForTransformFeedback())
+    {
+        std::vector<const char*> varyings;
+        for (auto const& s : mTransformFeedbackVaryings)
+            varyings.push_back(s.c_str());
+        glTransformFeedbackVaryings(mObjectName, (GLsizei)varyings.size(), varyings.data(), mTransformFeedbackMode);
+        mIsLinkedForTransformFeedback = true;
+    }
+}
+
 void Program::link(bool saveUniformState)
 {
     checkValidGLOW();
     GLOW_ACTION();
 
+    // a pending link would overwrite this one
+    finishLink();
+
     // save uniforms
-    auto uniforms = saveUniformState ? getUniforms() : nullptr;
+    mPendingUniforms = saveUniformState ? getUniforms() : nullptr;
 
-    auto requiresRelink = true;
-    auto linkCnt = 0;
-    while (requiresRelink)
-    {
-        requiresRelink = false;
+    startLink();
+    if (sParallelCompilation)
+        sPendingLinks.push_back(this);
+    else
+        finishLink();
+}
 
-        // set attribute locations
-        for (auto const& mapping : mAttributeMapping->getMap())
-            glBindAttribLocation(mObjectName, mapping.second, mapping.first.c_str());
+void Program::startLink()
+{
+    checkValidGLOW();
+    GLOW_ACTION();
 
-        // set fragment locations
-        for (auto const& mapping : mFragmentMapping->getMap())
-            glBindFragDataLocation(mObjectName, mapping.second, mapping.first.c_str());
+    mLinkPending = true;
+    bindLocations();
 
-        // set transform feedback
-        if (isConfiguredForTransformFeedback())
-        {
-            std::vector<const char*> varyings;
-            for (auto const& s : mTransformFeedbackVaryings)
-                varyings.push_back(s.c_str());
-            glTransformFeedbackVaryings(mObjectName, (GLsizei)varyings.size(), varyings.data(), mTransformFeedbackMode);
-            mIsLinkedForTransformFeedback = true;
-        }
+    mLinkedFromBinary = !sBinaryCacheDirectory.empty() && loadBinary();
+    if (mLinkedFromBinary)
+        return; // no compiling at all
 
-        ++linkCnt;
-        if (!linkAndCheckErrors())
+    // shaders created during parallel compilation are not compiled yet
+    for (auto const& s : mShader)
+        if (!s->isCompiled() && !s->hasErrors() && !s->mCompilePending)
+            s->startCompile();
+
+    if (!sBinaryCacheDirectory.empty())
+        glProgramParameteri(mObjectName, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(mObjectName);
+}
+
+void Program::finishLink()
+{
+    if (!mLinkPending)
+        return;
+
+    checkValidGLOW();
+    GLOW_ACTION();
+
+    mLinkPending = false;
+    sPendingLinks.erase(std::remove(sPendingLinks.begin(), sPendingLinks.end(), this), sPendingLinks.end());
+    auto uniforms = std::move(mPendingUniforms);
+
+    if (!mLinkedFromBinary)
+    {
+        for (auto const& s : mShader)
+            s->finishCompile();
+        if (!checkLinkErrors())
             return; // ERROR!
+    }
+
+    auto linkCnt = 1;
+    while (true)
+    {
+        auto requiresRelink = false;
 
         // get attribute locations
         GLint maxAttrLength = 0;
@@ -301,12 +507,36 @@ void Program::link(bool saveUniformState)
                 requiresRelink = true;
         }
 
+        if (!requiresRelink)
+            break;
+
         // sanity
         if (linkCnt > 2)
         {
             warning() << "Linking does not converge. Aborting. " << to_string(this);
             break;
         }
+
+        // relinking needs the compiled shaders
+        if (mLinkedFromBinary)
+        {
+            for (auto const& s : mShader)
+                if (!s->isCompiled() && !s->hasErrors())
+                    s->compile();
+            mLinkedFromBinary = false;
+        }
+
+        bindLocations();
+        ++linkCnt;
+        if (!linkAndCheckErrors())
+            return; // ERROR!
+    }
+
+    // a cached binary was checked before it was stored
+    if (mLinkedFromBinary)
+    {
+        mCheckedForAttributeLocationLayout = true;
+        mCheckedForFragmentLocationLayout = true;
     }
 
     // perform layout location check
@@ -411,6 +641,9 @@ void Program::link(bool saveUniformState)
         mCheckedForFragmentLocationLayout = true;
     }
 
+    if (!mLinkedFromBinary && !sBinaryCacheDirectory.empty())
+        saveBinary();
+
     // rebind uniform buffers
     for (auto const& kvp : mUniformBuffers)
         setUniformBuffer(kvp.first, kvp.second);
@@ -456,6 +689,7 @@ void Program::link(bool saveUniformState)
 
     auto now = std::chrono::system_clock::now().time_since_epoch();
     mLastTimeLinked = std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+    ++mLinkCount;
 }
 
 void Program::checkUnchangedUniforms()
@@ -466,7 +700,7 @@ void Program::checkUnchangedUniforms()
         return; // warning disabled
 
     for (auto const& info : mUniformCache)
-        if (!info.wasSet && !isImageUniform(info.type))
+        if (!info.wasSet && info.location >= 0 && !isImageUniform(info.type)) // location -1: member of a uniform block
         {
             warning() << "Uniform `" << info.name << "' is used in the shader but was not set via GLOW. " << to_string(this);
             warning() << "  (This also applies for uniforms with default values. We recommend making them non-uniform "
@@ -552,12 +786,25 @@ SharedProgram Program::create(const std::vector<SharedShader>& shader)
     return program;
 }
 
-SharedProgram Program::createFromFile(const std::string& fileOrBaseName)
+SharedShader Program::createShader(GLenum type, const std::string& content, const std::string& realFileName, const std::vector<std::string>& defines)
+{
+    if (!realFileName.empty())
+        return Shader::createFromFile(type, realFileName, defines);
+
+    auto shader = std::make_shared<Shader>(type);
+    shader->mDefines = defines;
+    shader->setSource(content);
+    if (!Shader::sDeferCompilation)
+        shader->compile();
+    return shader;
+}
+
+SharedProgram Program::createFromFile(const std::string& fileOrBaseName, const std::vector<std::string>& defines)
 {
     GLOW_ACTION();
 
     auto program = std::make_shared<Program>();
-    program->setObjectLabel(fileOrBaseName);
+    program->setObjectLabel(defines.empty() ? fileOrBaseName : fileOrBaseName + " [" + util::joinToString(defines) + "]");
     GLenum type;
     std::string content;
     std::string realFileName;
@@ -565,10 +812,7 @@ SharedProgram Program::createFromFile(const std::string& fileOrBaseName)
     // try to resolve file directly
     if (Shader::resolveFile(fileOrBaseName, type, content, realFileName))
     {
-        if (!realFileName.empty())
-            program->attachShader(Shader::createFromFile(type, realFileName));
-        else
-            program->attachShader(Shader::createFromSource(type, content));
+        program->attachShader(createShader(type, content, realFileName, defines));
     }
     else // otherwise check endings
     {
@@ -582,10 +826,7 @@ SharedProgram Program::createFromFile(const std::string& fileOrBaseName)
             {
                 if (Shader::resolveFile(fname + kvp.first, type, content, realFileName))
                 {
-                    if (!realFileName.empty())
-                        program->attachShader(Shader::createFromFile(type, realFileName));
-                    else
-                        program->attachShader(Shader::createFromSource(type, content));
+                    program->attachShader(createShader(type, content, realFileName, defines));
 
                     if (!wasStripped)
                         foundAnyWithoutStripping = true;
@@ -618,12 +859,13 @@ SharedProgram Program::createFromFile(const std::string& fileOrBaseName)
     return program;
 }
 
-SharedProgram Program::createFromFiles(const std::vector<std::string>& filenames)
+SharedProgram Program::createFromFiles(const std::vector<std::string>& filenames, const std::vector<std::string>& defines)
 {
     GLOW_ACTION();
 
     auto program = std::make_shared<Program>();
-    program->setObjectLabel(util::joinToString(filenames));
+    auto label = util::joinToString(filenames);
+    program->setObjectLabel(defines.empty() ? label : label + " [" + util::joinToString(defines) + "]");
     GLenum type;
     std::string content;
     std::string realFileName;
@@ -631,10 +873,7 @@ SharedProgram Program::createFromFiles(const std::vector<std::string>& filenames
     for (auto const& filename : filenames)
         if (Shader::resolveFile(filename, type, content, realFileName))
         {
-            if (!realFileName.empty())
-                program->attachShader(Shader::createFromFile(type, realFileName));
-            else
-                program->attachShader(Shader::createFromSource(type, content));
+            program->attachShader(createShader(type, content, realFileName, defines));
         }
         else
             error() << "Unable to resolve shader file '" << filename << "'. " << to_string(program.get());
@@ -646,6 +885,7 @@ SharedProgram Program::createFromFiles(const std::vector<std::string>& filenames
 UsedProgram::UsedProgram(Program* program) : program(program)
 {
     checkValidGLOW();
+    program->finishLink(); // see Program::beginParallelCompilation
     glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
     glUseProgram(program->mObjectName);
 
@@ -12,6 +12,7 @@
 #include <glow/util/LocationMapping.hh>
 
 #include "NamedObject.hh"
+#include "UniformHandle.hh"
 
 #include "raii/UsedProgram.hh"
 
@@ -52,6 +53,12 @@ private:
     /// If true, shader check for shader reloading periodically
     static bool sCheckShaderReloading;
 
+    /// Directory of the program binary cache, empty if disabled
+    static std::string sBinaryCacheDirectory;
+    /// If true, link() only starts linking (see beginParallelCompilation)
+    static bool sParallelCompilation;
+    /// Programs with a started but unfinished link
+    static std::vector<Program*> sPendingLinks;
 
     /// OpenGL object name
     GLuint mObjectName;
@@ -62,6 +69,8 @@ private:
     int64_t mLastReloadCheck = 0;
     /// Last time this shader was linked
     int64_t mLastTimeLinked = 0;
+    /// Number of links so far (handles re-resolve when this changes)
+    int mLinkCount = 0;
 
     /// Uniform lookup cache
     /// Invalidates after link
@@ -112,6 +121,15 @@ private:
     /// true if already checked for layout(loc)
     bool mCheckedForFragmentLocationLayout = false;
 
+    /// true if link() was started but not finished yet
+    bool mLinkPending = false;
+    /// true if the pending link was loaded from the binary cache
+    bool mLinkedFromBinary = false;
+    /// Key in the binary cache, from sources, locations and driver
+    uint64_t mBinaryKey = 0;
+    /// Uniforms to restore when the pending link finishes
+    SharedUniformState mPendingUniforms;
+
     /// disables unchanged uniform warning
     bool mWarnOnUnchangedUniforms = true;
     /// true if already checked for unchanged uniforms
@@ -121,6 +139,22 @@ private:
     /// Internal linking
     /// returns false on errors
     bool linkAndCheckErrors();
+    /// returns false on errors (after glLinkProgram or glProgramBinary)
+    bool checkLinkErrors();
+    /// Binds attribute/fragment locations and transform feedback varyings for the next link
+    void bindLocations();
+
+    /// Binds locations, then loads the binary from the cache or compiles and links without waiting
+    void startLink();
+    /// Waits for startLink(), checks errors and locations and updates all cached state
+    void finishLink();
+
+    /// Path of this program in the binary cache
+    std::string binaryCachePath() const;
+    /// glProgramBinary from the cache, returns false if missing or rejected by the driver
+    bool loadBinary();
+    /// glGetProgramBinary to the cache
+    void saveBinary();
 
     /// Restores additional "program state", like textures and shader buffers
     void restoreExtendedState();
@@ -136,6 +170,10 @@ private:
     /// Also verifies that the uniform types match
     GLint useUniformLocationAndVerify(std::string const& name, GLint size, GLenum type);
 
+    /// returns uniform location for a handle and sets "wasSet" to true
+    /// Verifies the type (not the array size), GL_INVALID_ENUM skips the check
+    GLint resolveUniformLocation(std::string const& name, GLenum type);
+
 public: // properties
     GLuint getObjectName() const { return mObjectName; }
     std::vector<SharedShader> const& getShader() const { return mShader; }
@@ -144,6 +182,7 @@ public: // properties
     LocationMapping const& getTextureUnitMapping() const { return mTextureUnitMapping; }
 
     GLOW_GETTER(LastTimeLinked);
+    GLOW_GETTER(LinkCount);
 
     GLOW_PROPERTY(WarnOnUnchangedUniforms);
 
@@ -156,6 +195,19 @@ public: // properties
     /// Modifies shader reloading state
     static void setShaderReloading(bool enabled);
 
+    /// Enables the program binary cache in the given directory (created if missing), empty disables it
+    /// Linked programs are stored there (glGetProgramBinary) and loaded instead of compiled next time
+    /// The key is a hash of the parsed sources, the attribute/fragment locations and the driver
+    static void setBinaryCacheDirectory(std::string const& dir);
+
+    /// Until finishParallelCompilation(), created programs only start compiling and linking
+    /// With GL_ARB_parallel_shader_compile (KHR on newer drivers), the driver does this for all of them concurrently
+    /// Shaders are not compiled at all if the program is in the binary cache
+    /// A pending program finishes its link on first use() at the latest
+    static void beginParallelCompilation();
+    /// Waits for all pending programs and reports their errors
+    static void finishParallelCompilation();
+
 public:
     /// Checks if all bound textures have valid mipmaps
     void validateTextureMipmaps() const;
@@ -211,6 +263,19 @@ public: // gl functions without use
 
     /// ========================================== UNIFORMS - END ==========================================
 
+    /// Creates a handle for a uniform, see UniformHandle.hh
+    /// The location is resolved lazily on first set (and after relinking)
+    /// Usage:
+    ///    auto uModel = prog->uniform<glm::mat4>("uModel");
+    ///    prog->use().setUniform(uModel, model);
+    template <typename DataT>
+    UniformHandle<DataT> uniform(std::string const& name)
+    {
+        return UniformHandle<DataT>(this, name);
+    }
+    /// Creates a handle for a texture uniform and reserves its texture unit
+    TextureHandle texture(std::string const& name);
+
 private:
     /// Internal generic getter for uniforms
     void implGetUniform(detail::glBaseType type, GLint loc, void* data) const;
@@ -276,9 +341,41 @@ public: // static construction
     /// Will also traverse "dots" if file not found to check for base versions
     /// E.g. createFromFile("mesh.opaque");
     ///   might find mesh.opaque.fsh and mesh.vsh
-    static SharedProgram createFromFile(std::string const& fileOrBaseName);
+    /// The defines ("NAME" or "NAME VALUE") are set in all shaders, e.g. to compile variants of one source
+    static SharedProgram createFromFile(std::string const& fileOrBaseName, std::vector<std::string> const& defines = {});
     /// Creates a program from a list of explicitly named files
     /// Shader type is determined by common/shader_endings.cc
-    static SharedProgram createFromFiles(std::vector<std::string> const& filenames);
+    static SharedProgram createFromFiles(std::vector<std::string> const& filenames, std::vector<std::string> const& defines = {});
+
+private:
+    /// From a file if realFileName is set, otherwise from content (see Shader::resolveFile)
+    static SharedShader createShader(GLenum type, std::string const& content, std::string const& realFileName, std::vector<std::string> const& defines);
 };
+
+template <typename DataT>
+void UsedProgram::setUniform(UniformHandle<DataT>& handle, typename UniformHandle<DataT>::value_type const& value) const
+{
+    auto linkCount = handle.mLinkCount;
+    if (!updateHandle(handle.mProgram, handle.mName, detail::uniformTypeOf<DataT>::type, handle.mLocation, handle.mLinkCount))
+        return;
+    if (linkCount != handle.mLinkCount)
+        handle.mHasValue = false; // relinked
+
+    if (handle.mHasValue && handle.mValue == value)
+        return; // redundant
+
+    handle.mValue = value;
+    handle.mHasValue = true;
+    detail::uniformTypeOf<DataT>::set(handle.mLocation, 1, &value);
+}
+
+template <typename DataT>
+void UsedProgram::setUniform(UniformHandle<DataT>& handle, int count, DataT const* values) const
+{
+    if (!updateHandle(handle.mProgram, handle.mName, detail::uniformTypeOf<DataT>::type, handle.mLocation, handle.mLinkCount))
+        return;
+
+    handle.mHasValue = false; // arrays are not filtered
+    detail::uniformTypeOf<DataT>::set(handle.mLocation, count, values);
+}
 }
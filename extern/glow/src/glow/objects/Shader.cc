@@ -16,6 +16,8 @@ using namespace glow;
 
 SharedShaderParser Shader::sParser = std::make_shared<DefaultShaderParser>();
 
+bool Shader::sDeferCompilation = false;
+
 Shader::Shader(GLenum shaderType) : mType(shaderType)
 {
     checkValidGLOW();
@@ -29,10 +31,26 @@ Shader::~Shader()
 }
 
 void Shader::compile()
+{
+    startCompile();
+    finishCompile();
+}
+
+void Shader::startCompile()
 {
     checkValidGLOW();
-    GLOW_ACTION();
     glCompileShader(mObjectName);
+    mCompilePending = true;
+}
+
+void Shader::finishCompile()
+{
+    if (!mCompilePending)
+        return;
+
+    checkValidGLOW();
+    GLOW_ACTION();
+    mCompilePending = false;
 
     // check error log
     GLint logLength = 0;
@@ -94,6 +112,15 @@ void Shader::setSource(const std::vector<std::string>& sources)
     for (auto i = 0u; i < parsedSources.size(); ++i)
         srcs[i] = parsedSources[i].c_str();
     glShaderSource(mObjectName, srcs.size(), srcs.data(), nullptr);
+
+    // FNV-1a
+    mSourceHash = 14695981039346656037ull;
+    for (auto const& s : parsedSources)
+        for (auto c : s)
+        {
+            mSourceHash ^= (uint8_t)c;
+            mSourceHash *= 1099511628211ull;
+        }
 }
 
 SharedShader Shader::createFromSource(GLenum shaderType, const std::string& source)
@@ -102,7 +129,8 @@ SharedShader Shader::createFromSource(GLenum shaderType, const std::string& sour
 
     auto shader = std::make_shared<Shader>(shaderType);
     shader->setSource(source);
-    shader->compile();
+    if (!sDeferCompilation)
+        shader->compile();
     return shader;
 }
 
@@ -112,7 +140,8 @@ SharedShader Shader::createFromSource(GLenum shaderType, const std::vector<std::
 
     auto shader = std::make_shared<Shader>(shaderType);
     shader->setSource(sources);
-    shader->compile();
+    if (!sDeferCompilation)
+        shader->compile();
     return shader;
 }
 
@@ -123,7 +152,7 @@ SharedShader Shader::createFromSource(GLenum shaderType, const unsigned char sou
     return createFromSource(shaderType, ss.str());
 }
 
-SharedShader Shader::createFromFile(GLenum shaderType, const std::string& filename)
+SharedShader Shader::createFromFile(GLenum shaderType, const std::string& filename, const std::vector<std::string>& defines)
 {
     GLOW_ACTION();
 
@@ -138,8 +167,10 @@ SharedShader Shader::createFromFile(GLenum shaderType, const std::string& filena
     shader->setObjectLabel(filename);
     shader->mFileName = filename;
     shader->mLastModification = util::fileModificationTime(filename);
+    shader->mDefines = defines;
     shader->setSource(util::readall(shaderFile));
-    shader->compile();
+    if (!sDeferCompilation)
+        shader->compile();
     return shader;
 }
 
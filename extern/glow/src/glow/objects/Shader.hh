@@ -32,6 +32,12 @@ class Shader final : public NamedObject<Shader, GL_SHADER>
     /// True iff shader has a compiled version
     bool mCompiled = false;
 
+    /// True iff compiling was started but its result not checked yet
+    bool mCompilePending = false;
+
+    /// If true, shaders are created without compiling them (see Program::beginParallelCompilation)
+    static bool sDeferCompilation;
+
     /// Filepath of this shader (if applicable)
     std::string mFileName;
     /// Last modification of the file (if applicable)
@@ -43,6 +49,12 @@ class Shader final : public NamedObject<Shader, GL_SHADER>
     /// Primary source of the shader
     std::vector<std::string> mSources;
 
+    /// Preprocessor defines ("NAME" or "NAME VALUE"), emitted by the parser after #version
+    std::vector<std::string> mDefines;
+
+    /// Hash of the parsed sources (includes resolved), see Program binary cache
+    uint64_t mSourceHash = 0;
+
 public: // getter
     GLuint getObjectName() const { return mObjectName; }
     GLenum getType() const { return mType; }
@@ -51,6 +63,8 @@ public: // getter
     bool isCompiledWithoutErrors() const { return mCompiled && !mHasErrors; }
     /// Returns non-empty filename if created from file, otherwise ""
     std::string const& getFileName() const { return mFileName; }
+    std::vector<std::string> const& getDefines() const { return mDefines; }
+    uint64_t getSourceHash() const { return mSourceHash; }
 
 public:
     Shader(GLenum shaderType);
@@ -60,6 +74,13 @@ public:
     /// Prints to the log should any error occur
     void compile();
 
+    /// Starts compiling without waiting for the result
+    /// With GL_ARB_parallel_shader_compile, the driver compiles in the background
+    void startCompile();
+    /// Checks the result of startCompile(), waits if necessary
+    /// Prints to the log should any error occur
+    void finishCompile();
+
     /// Fetches new source from disk (if backed by file)
     /// And recompiles
     void reload();
@@ -92,7 +113,8 @@ public: // static construction
     /// Helper for embedded source files
     static SharedShader createFromSource(GLenum shaderType, const unsigned char source[]);
     /// Creates and compiles (!) a shader by loading the specified file
-    static SharedShader createFromFile(GLenum shaderType, std::string const& filename);
+    /// The defines are kept on reload, so one file can be compiled in several variants
+    static SharedShader createFromFile(GLenum shaderType, std::string const& filename, std::vector<std::string> const& defines = {});
 
     friend class Program;
     friend class ShaderParser;
@@ -58,6 +58,15 @@ void BoundShaderStorageBuffer::setData(size_t size, const void* data, GLenum usa
     glBufferData(GL_SHADER_STORAGE_BUFFER, size, data, usage);
 }
 
+void BoundShaderStorageBuffer::setSubData(size_t offset, size_t size, const void* data)
+{
+    if (!isCurrent())
+        return;
+
+    checkValidGLOW();
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, offset, size, data);
+}
+
 void BoundShaderStorageBuffer::getData(void* destination, size_t maxSize, bool warnOnTruncate)
 {
     auto size = getSize();
@@ -447,16 +447,40 @@ void Texture2D::BoundTexture2D::setData(GLenum internalFormat, const SharedTextu
     if (!isCurrent())
         return;
 
-    texture->mInternalFormat = internalFormat; // format first, then resize
-    resize(data->getWidth(), data->getHeight());
+    // pre-compressed data brings all its mipmaps (e.g. DDS)
+    auto compressed = !data->getSurfaces().empty() && data->getSurfaces()[0]->isCompressed();
+    if (compressed)
+    {
+        checkValidGLOW();
+        GLOW_RUNTIME_ASSERT(!texture->isStorageImmutable(), "Texture is storage immutable " << to_string(texture), return );
 
-    // set all level 0 surfaces
-    for (auto const &surf : data->getSurfaces())
-        if (surf->getMipmapLevel() == 0)
-            setSubData(surf->getOffsetX(), surf->getOffsetY(),
-                       surf->getWidth(), surf->getHeight(),
-                       surf->getFormat(), surf->getType(),
-                       surf->getData().data(), surf->getMipmapLevel());
+        texture->mInternalFormat = internalFormat;
+        texture->mWidth = data->getWidth();
+        texture->mHeight = data->getHeight();
+
+        auto maxLevel = 0;
+        for (auto const &surf : data->getSurfaces())
+        {
+            glCompressedTexImage2D(texture->mTarget, surf->getMipmapLevel(), internalFormat, surf->getWidth(), surf->getHeight(), 0,
+                                   (GLsizei)surf->getDataSize(), surf->getDataPtr());
+            maxLevel = glm::max(maxLevel, surf->getMipmapLevel());
+        }
+        glTexParameteri(texture->mTarget, GL_TEXTURE_MAX_LEVEL, maxLevel);
+        texture->mMipmapsGenerated = maxLevel > 0;
+    }
+    else
+    {
+        texture->mInternalFormat = internalFormat; // format first, then resize
+        resize(data->getWidth(), data->getHeight());
+
+        // set all level 0 surfaces
+        for (auto const &surf : data->getSurfaces())
+            if (surf->getMipmapLevel() == 0)
+                setSubData(surf->getOffsetX(), surf->getOffsetY(),
+                           surf->getWidth(), surf->getHeight(),
+                           surf->getFormat(), surf->getType(),
+                           surf->getDataPtr(), surf->getMipmapLevel());
+    }
 
     // set parameters
     if (data->getAnisotropicFiltering() >= 1.f)
@@ -476,6 +500,9 @@ void Texture2D::BoundTexture2D::setData(GLenum internalFormat, const SharedTextu
     if (data->getCompareFunction() != GL_INVALID_ENUM)
         setCompareFunc(data->getCompareFunction());
 
+    if (compressed)
+        return;
+
     // generate mipmaps
     if (texture->hasMipmapsEnabled())
         generateMipmaps();
@@ -486,7 +513,7 @@ void Texture2D::BoundTexture2D::setData(GLenum internalFormat, const SharedTextu
             setSubData(surf->getOffsetX(), surf->getOffsetY(),
                        surf->getWidth(), surf->getHeight(),
                        surf->getFormat(), surf->getType(),
-                       surf->getData().data(), surf->getMipmapLevel());
+                       surf->getDataPtr(), surf->getMipmapLevel());
 }
 
 void Texture2D::clear(GLenum format, GLenum type, const GLvoid* data, int mipmapLevel)
@@ -451,16 +451,55 @@ void Texture2DArray::BoundTexture2DArray::setData(GLenum internalFormat, const S
     if (!isCurrent())
         return;
 
-    texture->mInternalFormat = internalFormat; // format first, then resize
-    resize(data->getWidth(), data->getHeight(), data->getDepth());
+    // pre-compressed data brings all its mipmaps (e.g. DDS), one surface per layer and level
+    auto compressed = !data->getSurfaces().empty() && data->getSurfaces()[0]->isCompressed();
+    if (compressed)
+    {
+        checkValidGLOW();
+        GLOW_RUNTIME_ASSERT(!texture->isStorageImmutable(), "Texture is storage immutable " << to_string(texture), return );
 
-    // set all level 0 surfaces
-    for (auto const &surf : data->getSurfaces())
-        if (surf->getMipmapLevel() == 0)
-            setSubData(surf->getOffsetX(), surf->getOffsetY(), surf->getOffsetZ(),
-                       surf->getWidth(), surf->getHeight(), surf->getDepth(),
-                       surf->getFormat(), surf->getType(),
-                       surf->getData().data(), surf->getMipmapLevel());
+        texture->mInternalFormat = internalFormat;
+        texture->mWidth = data->getWidth();
+        texture->mHeight = data->getHeight();
+        texture->mLayers = data->getDepth();
+
+        // allocate every level (the layers of a level are one image), then fill the layers
+        // without a bound unpack buffer, otherwise the null data would be an offset into it
+        auto maxLevel = 0;
+        for (auto const &surf : data->getSurfaces())
+            maxLevel = glm::max(maxLevel, surf->getMipmapLevel());
+        GLint unpackBuffer = 0;
+        glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &unpackBuffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        for (auto level = 0; level <= maxLevel; ++level)
+            for (auto const &surf : data->getSurfaces())
+                if (surf->getMipmapLevel() == level)
+                {
+                    glCompressedTexImage3D(texture->mTarget, level, internalFormat, surf->getWidth(), surf->getHeight(), texture->mLayers, 0,
+                                           (GLsizei)surf->getDataSize() * texture->mLayers, nullptr);
+                    break;
+                }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, unpackBuffer);
+
+        for (auto const &surf : data->getSurfaces())
+            glCompressedTexSubImage3D(texture->mTarget, surf->getMipmapLevel(), 0, 0, surf->getOffsetZ(), surf->getWidth(), surf->getHeight(), 1,
+                                      internalFormat, (GLsizei)surf->getDataSize(), surf->getDataPtr());
+        glTexParameteri(texture->mTarget, GL_TEXTURE_MAX_LEVEL, maxLevel);
+        texture->mMipmapsGenerated = maxLevel > 0;
+    }
+    else
+    {
+        texture->mInternalFormat = internalFormat; // format first, then resize
+        resize(data->getWidth(), data->getHeight(), data->getDepth());
+
+        // set all level 0 surfaces
+        for (auto const &surf : data->getSurfaces())
+            if (surf->getMipmapLevel() == 0)
+                setSubData(surf->getOffsetX(), surf->getOffsetY(), surf->getOffsetZ(),
+                           surf->getWidth(), surf->getHeight(), surf->getDepth(),
+                           surf->getFormat(), surf->getType(),
+                           surf->getData().data(), surf->getMipmapLevel());
+    }
 
     // set parameters
     if (data->getAnisotropicFiltering() >= 1.f)
@@ -480,6 +519,9 @@ void Texture2DArray::BoundTexture2DArray::setData(GLenum internalFormat, const S
     if (data->getCompareFunction() != GL_INVALID_ENUM)
         setCompareFunc(data->getCompareFunction());
 
+    if (compressed)
+        return;
+
     // generate mipmaps
     if (texture->hasMipmapsEnabled())
         generateMipmaps();
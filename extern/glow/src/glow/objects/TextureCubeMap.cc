@@ -452,16 +452,40 @@ void TextureCubeMap::BoundTextureCubeMap::setData(GLenum internalFormat, const S
     if (!isCurrent())
         return;
 
-    texture->mInternalFormat = internalFormat; // format first, then resize
-    resize(data->getWidth(), data->getHeight());
+    // pre-compressed data brings all its mipmaps (e.g. DDS)
+    auto compressed = !data->getSurfaces().empty() && data->getSurfaces()[0]->isCompressed();
+    if (compressed)
+    {
+        checkValidGLOW();
+        GLOW_RUNTIME_ASSERT(!texture->isStorageImmutable(), "Texture is storage immutable " << to_string(texture), return );
 
-    // set all level 0 surfaces
-    for (auto const &surf : data->getSurfaces())
-        if (surf->getMipmapLevel() == 0)
-            setSubData(surf->getTarget(), surf->getOffsetX(), surf->getOffsetY(),
-                       surf->getWidth(), surf->getHeight(),
-                       surf->getFormat(), surf->getType(),
-                       surf->getData().data(), surf->getMipmapLevel());
+        texture->mInternalFormat = internalFormat;
+        texture->mWidth = data->getWidth();
+        texture->mHeight = data->getHeight();
+
+        auto maxLevel = 0;
+        for (auto const &surf : data->getSurfaces())
+        {
+            glCompressedTexImage2D(surf->getTarget(), surf->getMipmapLevel(), internalFormat, surf->getWidth(), surf->getHeight(), 0,
+                                   (GLsizei)surf->getDataSize(), surf->getDataPtr());
+            maxLevel = glm::max(maxLevel, surf->getMipmapLevel());
+        }
+        glTexParameteri(texture->mTarget, GL_TEXTURE_MAX_LEVEL, maxLevel);
+        texture->mMipmapsGenerated = maxLevel > 0;
+    }
+    else
+    {
+        texture->mInternalFormat = internalFormat; // format first, then resize
+        resize(data->getWidth(), data->getHeight());
+
+        // set all level 0 surfaces
+        for (auto const &surf : data->getSurfaces())
+            if (surf->getMipmapLevel() == 0)
+                setSubData(surf->getTarget(), surf->getOffsetX(), surf->getOffsetY(),
+                           surf->getWidth(), surf->getHeight(),
+                           surf->getFormat(), surf->getType(),
+                           surf->getDataPtr(), surf->getMipmapLevel());
+    }
 
     // set parameters
     if (data->getAnisotropicFiltering() >= 1.f)
@@ -477,6 +501,9 @@ void TextureCubeMap::BoundTextureCubeMap::setData(GLenum internalFormat, const S
     if (data->getCompareFunction() != GL_INVALID_ENUM)
         setCompareFunc(data->getCompareFunction());
 
+    if (compressed)
+        return;
+
     // generate mipmaps
     if (texture->hasMipmapsEnabled())
         generateMipmaps();
@@ -487,7 +514,7 @@ void TextureCubeMap::BoundTextureCubeMap::setData(GLenum internalFormat, const S
             setSubData(surf->getTarget(), surf->getOffsetX(), surf->getOffsetY(),
                        surf->getWidth(), surf->getHeight(),
                        surf->getFormat(), surf->getType(),
-                       surf->getData().data(), surf->getMipmapLevel());
+                       surf->getDataPtr(), surf->getMipmapLevel());
 }
 
 void TextureCubeMap::clear(GLenum format, GLenum type, const GLvoid* data, int mipmapLevel)
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/matrix.hpp>
+
+#include <glow/gl.hh>
+
+namespace glow
+{
+class Program;
+struct UsedProgram;
+
+namespace detail
+{
+/// Compile-time uniform type and glUniform* call for handle types
+template <typename DataT>
+struct uniformTypeOf;
+
+#define GLOW_UNIFORM_TYPE_OF(TYPE, GLTYPE, CALL)                                \
+    template <>                                                                 \
+    struct uniformTypeOf<TYPE>                                                  \
+    {                                                                           \
+        static constexpr GLenum type = GLTYPE;                                  \
+        static void set(GLint loc, GLsizei count, TYPE const* values) { CALL; } \
+    }
+
+GLOW_UNIFORM_TYPE_OF(int32_t, GL_INT, glUniform1iv(loc, count, values));
+GLOW_UNIFORM_TYPE_OF(uint32_t, GL_UNSIGNED_INT, glUniform1uiv(loc, count, values));
+GLOW_UNIFORM_TYPE_OF(float, GL_FLOAT, glUniform1fv(loc, count, values));
+
+GLOW_UNIFORM_TYPE_OF(glm::vec2, GL_FLOAT_VEC2, glUniform2fv(loc, count, (GLfloat const*)values));
+GLOW_UNIFORM_TYPE_OF(glm::vec3, GL_FLOAT_VEC3, glUniform3fv(loc, count, (GLfloat const*)values));
+GLOW_UNIFORM_TYPE_OF(glm::vec4, GL_FLOAT_VEC4, glUniform4fv(loc, count, (GLfloat const*)values));
+GLOW_UNIFORM_TYPE_OF(glm::ivec2, GL_INT_VEC2, glUniform2iv(loc, count, (GLint const*)values));
+GLOW_UNIFORM_TYPE_OF(glm::ivec3, GL_INT_VEC3, glUniform3iv(loc, count, (GLint const*)values));
+GLOW_UNIFORM_TYPE_OF(glm::ivec4, GL_INT_VEC4, glUniform4iv(loc, count, (GLint const*)values));
+
+GLOW_UNIFORM_TYPE_OF(glm::mat3, GL_FLOAT_MAT3, glUniformMatrix3fv(loc, count, GL_FALSE, (GLfloat const*)values));
+GLOW_UNIFORM_TYPE_OF(glm::mat4, GL_FLOAT_MAT4, glUniformMatrix4fv(loc, count, GL_FALSE, (GLfloat const*)values));
+
+#undef GLOW_UNIFORM_TYPE_OF
+
+// bool is uploaded as int
+template <>
+struct uniformTypeOf<bool>
+{
+    static constexpr GLenum type = GL_BOOL;
+    static void set(GLint loc, GLsizei count, bool const* values)
+    {
+        std::vector<int32_t> tmp(values, values + count);
+        glUniform1iv(loc, count, tmp.data());
+    }
+};
+}
+
+/**
+ * A uniform that is looked up by name only once
+ *
+ * Usage:
+ *   UniformHandle<glm::mat4> uModel = program->uniform<glm::mat4>("uModel"); // at init
+ *   program->use().setUniform(uModel, model);                               // per draw
+ *
+ * The location is re-resolved automatically when the program is relinked.
+ * Setting the same value twice is filtered (single values only, not arrays).
+ * A handle belongs to exactly one program.
+ */
+template <typename DataT>
+class UniformHandle
+{
+public:
+    using value_type = DataT;
+
+private:
+    Program* mProgram = nullptr;
+    std::string mName;
+
+    /// location for the link with index mLinkCount
+    GLint mLocation = -1;
+    int mLinkCount = -1;
+
+    /// last value set via this handle
+    bool mHasValue = false;
+    DataT mValue;
+
+    UniformHandle(Program* program, std::string name) : mProgram(program), mName(std::move(name)) {}
+    friend class Program;
+    friend struct UsedProgram;
+
+public:
+    UniformHandle() = default;
+
+    Program* getProgram() const { return mProgram; }
+    std::string const& getName() const { return mName; }
+};
+
+/**
+ * A texture uniform whose unit is assigned only once
+ *
+ * Usage:
+ *   TextureHandle uTexAlbedo = program->texture("uTexAlbedo"); // at init
+ *   program->use().setTexture(uTexAlbedo, tex);                // per draw
+ *
+ * Binding the texture that is already bound to the unit is skipped.
+ */
+class TextureHandle
+{
+    Program* mProgram = nullptr;
+    std::string mName;
+    GLuint mUnit = 0;
+
+    /// location for the link with index mLinkCount
+    GLint mLocation = -1;
+    int mLinkCount = -1;
+
+    TextureHandle(Program* program, std::string name, GLuint unit) : mProgram(program), mName(std::move(name)), mUnit(unit) {}
+    friend class Program;
+    friend struct UsedProgram;
+
+public:
+    TextureHandle() = default;
+
+    Program* getProgram() const { return mProgram; }
+    std::string const& getName() const { return mName; }
+    GLuint getUnit() const { return mUnit; }
+};
+}
@@ -180,6 +180,54 @@ void BoundVertexArray::drawRange(GLsizei start, GLsizei end, GLsizei instanceCou
     notifyShaderExecuted();
 }
 
+void BoundVertexArray::drawIndirect(SharedBuffer const& commands, size_t offset)
+{
+    if (!isCurrent())
+        return;
+
+    checkValidGLOW();
+    negotiateBindings();
+
+    if (Program::getCurrentProgram() == nullptr)
+        glow::warning() << "Drawing without any shader used (did you forget to call Program::use()?). " << to_string(vao);
+
+    updatePatchParameters();
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commands->getObjectName());
+    if (vao->mElementArrayBuffer)
+        glDrawElementsIndirect(vao->mPrimitiveMode, vao->mElementArrayBuffer->getIndexType(), (void const*)offset);
+    else
+        glDrawArraysIndirect(vao->mPrimitiveMode, (void const*)offset);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    // notify FBOs
+    notifyShaderExecuted();
+}
+
+void BoundVertexArray::multiDrawIndirect(SharedBuffer const& commands, int drawCount, size_t offset, size_t stride)
+{
+    if (!isCurrent())
+        return;
+
+    checkValidGLOW();
+    negotiateBindings();
+
+    if (Program::getCurrentProgram() == nullptr)
+        glow::warning() << "Drawing without any shader used (did you forget to call Program::use()?). " << to_string(vao);
+
+    updatePatchParameters();
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commands->getObjectName());
+    if (vao->mElementArrayBuffer)
+        glMultiDrawElementsIndirect(vao->mPrimitiveMode, vao->mElementArrayBuffer->getIndexType(), (void const*)offset, drawCount, (GLsizei)stride);
+    else
+        glMultiDrawArraysIndirect(vao->mPrimitiveMode, (void const*)offset, drawCount, (GLsizei)stride);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    // notify FBOs
+    notifyShaderExecuted();
+}
+
 void BoundVertexArray::drawTransformFeedback(const SharedTransformFeedback& feedback)
 {
     if (!isCurrent())
@@ -42,6 +42,15 @@ struct BoundArrayBuffer
         implSetData(sizeof(DataT) * N, data, sizeof(DataT), usage);
     }
 
+    /// Allocates immutable storage (glBufferStorage), e.g. GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT
+    /// setData cannot be used afterwards
+    void setStorage(size_t sizeInBytes, GLbitfield flags);
+
+    /// Maps a part of the buffer (glMapBufferRange)
+    /// A GL_MAP_PERSISTENT_BIT mapping stays valid while the buffer is used for drawing, until unmap()
+    void* mapRange(size_t offset, size_t sizeInBytes, GLbitfield access);
+    void unmap();
+
 private:
     GLint previousBuffer;                ///< previously bound buffer
     BoundArrayBuffer* previousBufferPtr; ///< previously bound buffer
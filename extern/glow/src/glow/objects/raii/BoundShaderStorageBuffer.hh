@@ -32,6 +32,21 @@ struct BoundShaderStorageBuffer
         setData(sizeof(data), &data, usage);
     }
 
+    /// Overwrites a part of the data, the buffer keeps its size
+    void setSubData(size_t offset, size_t size, const void* data);
+    /// Overwrites a part of the data (vector-of-data version), offset in bytes
+    template <typename DataT>
+    void setSubData(size_t offset, std::vector<DataT> const& data)
+    {
+        setSubData(offset, data.size() * sizeof(DataT), data.data());
+    }
+    /// Overwrites a part of the data (POD version), offset in bytes
+    template <typename DataT>
+    void setSubData(size_t offset, DataT const& data)
+    {
+        setSubData(offset, sizeof(data), &data);
+    }
+
     /// Writes all buffer data into the given memory
     /// Data is truncated to maxSize
     void getData(void* destination, size_t maxSize = 0, bool warnOnTruncate = true);
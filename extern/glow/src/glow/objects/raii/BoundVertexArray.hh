@@ -27,6 +27,13 @@ public: // gl function that require binding
     void draw(GLsizei instanceCount = -1);
     /// Same as draw(...) but only renders a subrange of indices or vertices
     void drawRange(GLsizei start, GLsizei end, GLsizei instanceCount = -1);
+    /// Same as draw(...) but reads count, instanceCount, first, ... from a buffer on the GPU
+    /// (DrawArraysIndirectCommand or DrawElementsIndirectCommand, depending on the EAB)
+    /// offset is in bytes
+    void drawIndirect(SharedBuffer const& commands, size_t offset = 0);
+    /// Same as drawIndirect(...) but for drawCount commands in a row (glMultiDraw*Indirect)
+    /// stride 0 means tightly packed
+    void multiDrawIndirect(SharedBuffer const& commands, int drawCount, size_t offset = 0, size_t stride = 0);
     /// Same as draw(...) but takes the number of vertices from a recorded transform feedback object
     /// NOTE: does not work with index buffers or instancing
     void drawTransformFeedback(SharedTransformFeedback const& feedback);
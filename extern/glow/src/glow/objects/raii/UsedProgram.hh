@@ -9,6 +9,7 @@
 #include <glow/common/non_copyable.hh>
 #include <glow/fwd.hh>
 #include <glow/gl.hh>
+#include <glow/objects/UniformHandle.hh>
 
 namespace glow
 {
@@ -33,6 +34,10 @@ public: // gl functions with use
     /// Requires an explicit binding location in shader (e.g. binding=N layout)
     /// Requires tex->isStorageImmutable()
     void setImage(int bindingLocation, SharedTexture const& tex, GLenum usage = GL_READ_WRITE, int mipmapLevel = 0, int layer = 0);
+    /// Binds a texture via a handle from Program::texture(name)
+    /// Does nothing if the texture is already bound to the handle's unit
+    /// Setting nullptr is ok
+    void setTexture(TextureHandle& handle, SharedTexture const& tex);
 
     /// ========================================= UNIFORMS - START =========================================
     /// This section defines the various ways of setting uniforms
@@ -153,6 +158,13 @@ public: // gl functions with use
         setUniformBool(name, (int)tmp.size(), tmp.data());
     }
 
+    /// Handle interface (see UniformHandle.hh)
+    /// Do not mix with setting the same uniform by name, that bypasses the redundancy filter
+    template <typename DataT>
+    void setUniform(UniformHandle<DataT>& handle, typename UniformHandle<DataT>::value_type const& value) const;
+    template <typename DataT>
+    void setUniform(UniformHandle<DataT>& handle, int count, DataT const* values) const;
+
     /// Applies all saved uniforms from that state
     void setUniforms(SharedUniformState const& state);
     /// Sets generic uniform data
@@ -183,6 +195,10 @@ private:
     /// Special case: overwrite uniform type
     void setUniformIntInternal(std::string const& name, int count, int32_t const* values, GLenum uniformType) const;
 
+    /// Re-resolves a handle location if the program was relinked
+    /// Returns false if the handle cannot be used (not current, wrong program, inactive uniform)
+    bool updateHandle(Program const* owner, std::string const& name, GLenum type, GLint& location, int& linkCount) const;
+
 private:
     GLint previousProgram;           ///< previously used program
     UsedProgram* previousProgramPtr; ///< previously used program
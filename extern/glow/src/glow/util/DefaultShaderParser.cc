@@ -305,6 +305,9 @@ std::vector<std::string> DefaultShaderParser::parse(Shader* shader, const std::v
     parsedSrc << "#version " + std::to_string(glow::OGLVersion.total * 10) + "\n";
 #endif
 
+    for (auto const& define : shader->getDefines())
+        parsedSrc << "#define " << define << "\n";
+
     int nextSrcIdx = sources.size();
 
     for (auto sIdx = 0u; sIdx < sources.size(); ++sIdx)
@@ -16,6 +16,7 @@ namespace glow
 /// * resolve custom registered #pragma keywords
 /// * includes have an implicit #pragma once
 /// * opengl #version is inserted automatically
+/// * the shader's defines are inserted after #version
 class DefaultShaderParser : public ShaderParser
 {
 public:
@@ -2,42 +2,33 @@
 
 #include <glow/common/log.hh>
 #include <glow/common/scoped_gl.hh>
-#include <glow/objects/ArrayBuffer.hh>
 #include <glow/objects/Program.hh>
 #include <glow/objects/VertexArray.hh>
 
 using namespace glow;
 
-BulletDebugger::BulletDebugger() {
+BulletDebugger::BulletDebugger(LineBuffer &lines) : lines(lines) {
   mLineShader = Program::createFromFile("../data/shaders/bullet");
+  mProjView = mLineShader->uniform<glm::mat4>("uProjView");
 }
 
 BulletDebugger::~BulletDebugger() {}
 
-void BulletDebugger::draw(glm::mat4 pPVMatrix) {
+void BulletDebugger::draw(glm::mat4 pPVMatrix, uint32_t categories) {
+  if (lines.empty(categories))
+    return;
+
   GLOW_SCOPED(enable, GL_DEPTH_TEST);
   GLOW_SCOPED(disable, GL_CULL_FACE);
 
   auto shader = mLineShader->use();
-  shader.setUniform("uProjView", pPVMatrix);
-
-  // bad? should reuse maybe?
-  // but only used for debugging so whatever
-  auto ab = ArrayBuffer::create();
-  ab->setObjectLabel("Bullet");
-  ab->defineAttributes({{&Vertex::pos, "position"}, //
-                        {&Vertex::color, "color"}});
-  ab->bind().setData(lines);
-
-  auto va = VertexArray::create(ab, GL_LINES);
-  va->setObjectLabel("Bullet");
-  va->bind().draw();
+  shader.setUniform(mProjView, pPVMatrix);
+  auto va = lines.getVertexArray()->bind();
+  lines.draw(va, categories);
 }
 
 void BulletDebugger::drawLine(const btVector3 &from, const btVector3 &to, const btVector3 &color) {
-  // cache lines
-  lines.push_back({{from.getX(), from.getY(), from.getZ()}, {color.getX(), color.getY(), color.getZ()}});
-  lines.push_back({{to.getX(), to.getY(), to.getZ()}, {color.getX(), color.getY(), color.getZ()}});
+  lines.line(LineBuffer::Physics, {from.getX(), from.getY(), from.getZ()}, {to.getX(), to.getY(), to.getZ()}, {color.getX(), color.getY(), color.getZ()});
 }
 
 void BulletDebugger::reportErrorWarning(const char *str) {
@@ -51,7 +42,3 @@ void BulletDebugger::setDebugMode(int p) {
 int BulletDebugger::getDebugMode(void) const {
   return mode;
 }
-
-void BulletDebugger::clearLines() {
-  lines.clear();
-}
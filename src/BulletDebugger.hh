@@ -2,18 +2,20 @@
 
 #include "btBulletDynamicsCommon.h"
 
-#include <vector>
-
 #include <glow/fwd.hh>
+#include <glow/objects/UniformHandle.hh>
 
 #include <glm/glm.hpp>
 
+#include "LineBuffer.hh"
+
+// lines go to the Physics category of the LineBuffer
 class BulletDebugger : public btIDebugDraw {
 public:
-  BulletDebugger();
+  BulletDebugger(LineBuffer &lines);
   ~BulletDebugger();
 
-  void draw(glm::mat4 pPVMatrix); // draw it with projection * view
+  void draw(glm::mat4 pPVMatrix, uint32_t categories); // draw it with projection * view
 
   // btIDebugDraw API
   void drawLine(const btVector3 &from, const btVector3 &to, const btVector3 &color) override;
@@ -22,15 +24,11 @@ public:
   void reportErrorWarning(const char *) override;
   void setDebugMode(int p) override;
   int getDebugMode(void) const override;
-  void clearLines() override;
+  void clearLines() override {} // LineBuffer::nextFrame
 
 private:
-  struct Vertex {
-    glm::vec3 pos;
-    glm::vec3 color;
-  };
-
   int mode = DBG_DrawWireframe;
-  std::vector<Vertex> lines;
+  LineBuffer &lines;
   glow::SharedProgram mLineShader;
+  glow::UniformHandle<glm::mat4> mProjView;
 };
\ No newline at end of file
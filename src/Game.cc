@@ -2,8 +2,8 @@
 
 #include <set>
 #include <algorithm>
-#include <future>
 #include <functional>
+#include <numeric>
 #include <exception>
 #include <random>
 
@@ -13,6 +13,7 @@
 #include <glow/common/log.hh>
 #include <glow/common/scoped_gl.hh>
 #include <glow/objects/ArrayBuffer.hh>
+#include <glow/objects/ElementArrayBuffer.hh>
 #include <glow/objects/Framebuffer.hh>
 #include <glow/objects/Program.hh>
 #include <glow/objects/Texture2D.hh>
@@ -20,12 +21,14 @@
 #include <glow/objects/TextureRectangle.hh>
 #include <glow/objects/VertexArray.hh>
 #include <glow/objects/TextureCubeMap.hh>
+#include <glow/objects/UniformBuffer.hh>
+#include <glow/objects/ShaderStorageBuffer.hh>
+#include <glow/objects/TimerQuery.hh>
 
 #include <glow/data/TextureData.hh>
 
 // extra functionality of glow
 #include <glow-extras/geometry/Quad.hh>
-#include <glow-extras/geometry/UVSphere.hh>
 
 #include <GLFW/glfw3.h> // window/input framework
 
@@ -36,7 +39,7 @@
 #include <assimp/DefaultLogger.hpp>
 #include "assimpModel.hh"
 
-#include "load_mesh.hh" // helper function for loading .obj into VertexArrays
+#include "load_mesh.hh" // helper functions for loading meshes into VertexArrays
 #include <soloud_speech.h>
 
 #include "conversion.hh"
@@ -48,33 +51,61 @@ GLOW_SHARED(class, btRigidBody);
 GLOW_SHARED(class, btMotionState);
 using defMotionState = std::shared_ptr<btDefaultMotionState>;
 
-struct AttMat {
-  glm::vec4 a, b, c, d;
+// compact instance data, the model matrix is rebuilt in instance.glsl
+struct CubeInstance {
+  glm::vec4 posScale; // xyz pos, w uniform scale
+  glm::vec4 rotation; // quaternion xyzw
 };
+static_assert(sizeof(CubeInstance) == 32, "tightly packed");
+
+// moving cubes also carry where they were last frame, for the velocity buffer
+// static ones read the current instance as the previous one (see the attributes in init)
+struct MovingCubeInstance {
+  glm::vec4 posScale;
+  glm::vec4 rotation;
+  glm::vec4 prevPosScale;
+  glm::vec4 prevRotation;
+};
+static_assert(sizeof(MovingCubeInstance) == 64, "tightly packed");
+
+// rockets always move, so they always carry last frame
+struct RocketInstance {
+  glm::vec4 posType; // xyz pos, w rtype
+  glm::vec4 velSpin; // xyz linear velocity, w rotation around y; homing: body rotation quaternion instead
+  glm::vec4 prevPosType; // last frame, for the velocity buffer
+  glm::vec4 prevVelSpin;
+};
+static_assert(sizeof(RocketInstance) == 64, "tightly packed");
 
 using namespace std;
 
+glm::vec3 HSV2RGB(float h, float s, float v) {
+  //based on:
+  //https://stackoverflow.com/questions/3018313/algorithm-to-convert-rgb-to-hsv-and-hsv-to-rgb-in-range-0-255-for-both
+  auto rgb = saturate(glm::vec3(abs(h * 6 - 3) - 1, //
+                                2 - abs(h * 6 - 2), //
+                                2 - abs(h * 6 - 4)));
+
+  return glm::vec3(((rgb - glm::vec3(1.)) * s + glm::vec3(1.)) * v);
+}
+
 struct Cube {
   glm::ivec3 pos;
   bool destroyable = false; // floor
   bool moves = false;
-};
-
-struct LineVertex {
-  glm::vec3 pos;
-  glm::vec3 color;
-};
-
-struct ExplVertex {
-  glm::vec3 pos;
-  glm::vec3 normal;
+  bool drawn = false;                    // prev* is valid
+  glm::vec4 prevPosScale = glm::vec4(0); // as drawn last frame
+  glm::vec4 prevRotation = glm::vec4(0);
 };
 
 struct Rocket {
   rtype type = rtype::forward;
   bool real = true;
   bool explode = false;
-  bool willSplit = false; // see banjo-tooie final boss
+  bool willSplit = false;               // see banjo-tooie final boss
+  bool drawn = false;                   // prev* is valid
+  glm::vec4 prevPosType = glm::vec4(0); // as drawn last frame
+  glm::vec4 prevVelSpin = glm::vec4(0);
   //SoLoud::handle = 0;
 };
 
@@ -99,7 +130,7 @@ void Game::init() {
 
   setTitle("Psychokinesis - I know how you'll feel"); // N.I. ?
 
-// start assimp logging
+// start assimp logging, before the loader imports on a worker (the logger is global)
 #ifndef NDEBUG
   Assimp::DefaultLogger::create();
 #endif
@@ -128,13 +159,21 @@ void Game::init() {
 
     // shadow
     {
-      // probably should resize as well but what size?
+      // size comes from the memory budget, see resizeShadows
       glGetIntegerv(GL_MAX_TEXTURE_SIZE, &mMaxShadowSize);
-      mShadowMapSize = mMaxShadowSize / mCurrentShadowFactor;
-      mBufferShadow = glow::TextureRectangle::create(mShadowMapSize, mShadowMapSize, GL_DEPTH_COMPONENT32F);
-      mBufferShadow->bind().setWrap(GL_CLAMP_TO_BORDER, GL_CLAMP_TO_BORDER);
-      mBufferShadow->bind().setCompareMode(GL_COMPARE_REF_TO_TEXTURE);
+      mBufferShadow = glow::TextureRectangle::create(1, 1, GL_DEPTH_COMPONENT16);
+      mBufferShadowNear = glow::TextureRectangle::create(1, 1, GL_DEPTH_COMPONENT16);
+      for (auto const &t : {mBufferShadow, mBufferShadowNear}) {
+        auto tex = t->bind();
+        tex.setWrap(GL_CLAMP_TO_BORDER, GL_CLAMP_TO_BORDER);
+        tex.setBorderColor(glm::vec4(1)); // outside is lit, the light cone falloff is in fuse.fsh
+        tex.setCompareMode(GL_COMPARE_REF_TO_TEXTURE);
+      }
       mFramebufferShadow = glow::Framebuffer::createDepthOnly(mBufferShadow);
+      mFramebufferShadowNear = glow::Framebuffer::createDepthOnly(mBufferShadowNear);
+      mBufferShadowStatic = glow::TextureRectangle::create(1, 1, GL_DEPTH_COMPONENT16);
+      mFramebufferShadowStatic = glow::Framebuffer::createDepthOnly(mBufferShadowStatic);
+      resizeShadows();
     }
 
     // depth
@@ -151,29 +190,27 @@ void Game::init() {
       mFramebufferFuse = glow::Framebuffer::create("fColor", mBufferFuse);
     }
 
-    // mode
-    {
-      //can't blend integers?
-      //mTargets.push_back(mBufferMode = glow::TextureRectangle::create(1, 1, GL_R8I)); // GL_RED_INTEGER misses implementation in glow?
-      mTargets.push_back(mBufferMode = glow::TextureRectangle::create(1, 1, GL_R16F));
-      mFramebufferMode = glow::Framebuffer::create("fMode", mBufferMode, mGBufferDepth);
+    // TAA
+    for (auto i = 0; i < 2; ++i) {
+      mBufferHistory[i] = glow::Texture2D::create(1, 1, GL_RGBA16F);
+      mBufferHistory[i]->bind().setMinFilter(GL_LINEAR); // disable mipmaps
+      mFramebufferHistory[i] = glow::Framebuffer::create("fColor", mBufferHistory[i]);
     }
 
     // GBuffer
     {
       // size is 1x1 for now and is changed onResize
-      mTargets.push_back(mGBufferAlbedo = glow::TextureRectangle::create(1, 1, GL_RGB16F));
-      mTargets.push_back(mGBufferMaterial = glow::TextureRectangle::create(1, 1, GL_RG16F));
-      mTargets.push_back(mGBufferNormal = glow::TextureRectangle::create(1, 1, GL_RGB16F));
-      auto fix = glow::TextureRectangle::create(1, 1, GL_R16F);
-      mTargets.push_back(fix);
+      // 12 bytes per pixel, encoding in data/shaders/gbuffer.glsl
+      mTargets.push_back(mGBufferAlbedo = glow::TextureRectangle::create(1, 1, GL_SRGB8_ALPHA8)); // SRGB8 is not renderable
+      mTargets.push_back(mGBufferMaterial = glow::TextureRectangle::create(1, 1, GL_RG8));        // metallic, roughness
+      mTargets.push_back(mGBufferNormal = glow::TextureRectangle::create(1, 1, GL_RG16));         // octahedral
+      mTargets.push_back(mGBufferVelocity = glow::TextureRectangle::create(1, 1, GL_RG16F));      // TAA
       mFramebufferGBuffer = glow::Framebuffer::create(
           {
               {"fAlbedo", mGBufferAlbedo},
-
               {"fMaterial", mGBufferMaterial},
               {"fNormal", mGBufferNormal},
-              {"fFIXMYBUG", fix} // WHY DOES THIS LINE FIX the last rectangle
+              {"fVelocity", mGBufferVelocity},
           },
           mGBufferDepth);
     }
@@ -185,165 +222,166 @@ void Game::init() {
     }
   }
 
+  // decoding runs on a worker pool while the main thread sets up meshes and shaders, see Loader
+  // textures are uploaded as soon as they are decoded, loader.wait() below blocks for the first frame ones
+  // phase 2 assets stream in during phase 1 (poll() in render) and are waited for in initPhase2
+  // all files but the shaders come from one mapped pack (see tools/pack.cc), or loose if it is missing
+  mPack = make_unique<Pack>("../data/data.pak", "../data/");
+  mLoader = make_unique<Loader>(*mPack);
+  auto &loader = *mLoader;
+
   // load gfx resources
   {
-    //load data async (PNG is slow!)
+    //load cooked textures (see tools/cook.cc), mapped and uploaded without decoding
     {
-      //filenames
-      string texPath = "../data/textures/";
-      string cubeAlbedoFN = texPath + "cube.albedo.png";
-      string cubeNormalFN = texPath + "cube.normal.png";
-      string cubeMetallicFN = texPath + "cube.metallic.png";
-      string cubeRoughnessFN = texPath + "cube.roughness.png";
-      string smallFN = texPath + "normal.png";
-      string bgPath = texPath + "galaxy/";
-      string mechAlbedoFN = texPath + "mech.albedo.";
-      string mechNormalFN = texPath + "mech.normal.";
-      string mechMaterialFN = texPath + "mech.material.";
-      string mechModelFN = "../data/models/mech/mech.fbx";
-      string healthBarFn = texPath + "ui/Health bar";
-      string rocketFN = texPath + "rocket.";
-      string paperFN = texPath + "paper.png";
-
-      //loading async
-      const auto policy = launch::async;
-
-      auto cubeAlbedoData = async(policy, glow::TextureData::createFromFile, cubeAlbedoFN, glow::ColorSpace::sRGB);
-      auto cubeNormalData = async(policy, glow::TextureData::createFromFile, cubeNormalFN, glow::ColorSpace::Linear);
-      auto cubeMetallicData = async(policy, glow::TextureData::createFromFile, cubeMetallicFN, glow::ColorSpace::Linear);
-      auto cubeRoughnessData = async(policy, glow::TextureData::createFromFile, cubeRoughnessFN, glow::ColorSpace::Linear);
-      auto bgData = async(policy, glow::TextureData::createFromFileCube, //
-                          bgPath + "right.png",                          //
-                          bgPath + "left.png",                           //
-                          bgPath + "top.png",                            //
-                          bgPath + "bottom.png",                         //
-                          bgPath + "front.png",                          //
-                          bgPath + "back.png",                           //
-                          glow::ColorSpace::sRGB);
-      auto mechAlbedoData0 = async(policy, glow::TextureData::createFromFile, mechAlbedoFN + "0.png", glow::ColorSpace::sRGB);
-      auto mechNormalData0 = async(policy, glow::TextureData::createFromFile, mechNormalFN + "0.png", glow::ColorSpace::Linear);
-      auto mechMaterialData0 = async(policy, glow::TextureData::createFromFile, mechMaterialFN + "0.png", glow::ColorSpace::Linear);
-      auto mechAlbedoData1 = async(policy, glow::TextureData::createFromFile, mechAlbedoFN + "1.png", glow::ColorSpace::sRGB);
-      auto mechNormalData1 = async(policy, glow::TextureData::createFromFile, mechNormalFN + "1.png", glow::ColorSpace::Linear);
-      auto mechMaterialData1 = async(policy, glow::TextureData::createFromFile, mechMaterialFN + "1.png", glow::ColorSpace::Linear);
-      auto mechAlbedoData2 = async(policy, glow::TextureData::createFromFile, mechAlbedoFN + "2.png", glow::ColorSpace::sRGB);
-      future<glow::SharedTextureData> healthBarData[MAX_HEALTH + 1];
-      for (int i = 0; i <= MAX_HEALTH; i++)
-        healthBarData[i] = std::async(policy, glow::TextureData::createFromFile, healthBarFn + to_string(i) + ".png", glow::ColorSpace::sRGB);
-      future<glow::SharedTextureData> rocketAlbedoData[NUM_ROCKET_TYPES];
-      future<glow::SharedTextureData> rocketNormalData[NUM_ROCKET_TYPES];
-      future<glow::SharedTextureData> rocketMetallicData[NUM_ROCKET_TYPES];
-      future<glow::SharedTextureData> rocketRoughnessData[NUM_ROCKET_TYPES];
-      for (int i = 0; i < NUM_ROCKET_TYPES; i++) {
-        rocketAlbedoData[i] = async(policy, glow::TextureData::createFromFile, rocketFN + "albedo." + to_string(i) + ".png", glow::ColorSpace::sRGB);
-        rocketNormalData[i] = async(policy, glow::TextureData::createFromFile, rocketFN + "normal." + to_string(i) + ".png", glow::ColorSpace::sRGB);
-        rocketMetallicData[i] = async(policy, glow::TextureData::createFromFile, rocketFN + "metallic." + to_string(i) + ".png", glow::ColorSpace::sRGB);
-        rocketRoughnessData[i] = async(policy, glow::TextureData::createFromFile, rocketFN + "roughness." + to_string(i) + ".png", glow::ColorSpace::sRGB);
-      }
-      auto paperData = async(policy, glow::TextureData::createFromFile, paperFN, glow::ColorSpace::sRGB);
-      //linear:
-      auto mechModelData = async(launch::deferred, AssimpModel::load, mechModelFN); // WHY DOES THIS BREAK WITH ASYNC?
-      //not into GL yet, could change
-      Mech::mesh = mechModelData.get();
-
-      //into GL
-      mTexCubeAlbedo = glow::Texture2D::createFromData(cubeAlbedoData.get());
-      mTexCubeAlbedo->setObjectLabel(cubeAlbedoFN);
-      mTexCubeNormal = glow::Texture2D::createFromData(cubeNormalData.get());
-      mTexCubeNormal->setObjectLabel(cubeNormalFN);
-      mTexCubeMetallic = glow::Texture2D::createFromData(cubeMetallicData.get());
-      mTexCubeMetallic->setObjectLabel(cubeMetallicFN);
-      mTexCubeRoughness = glow::Texture2D::createFromData(cubeRoughnessData.get());
-      mTexCubeRoughness->setObjectLabel(cubeRoughnessFN);
-      mSkybox = glow::TextureCubeMap::createFromData(bgData.get());
-      mSkybox->setObjectLabel(bgPath);
-      mechs[player].texAlbedo = glow::Texture2D::createFromData(mechAlbedoData0.get());
-      mechs[player].texAlbedo->setObjectLabel(mechAlbedoFN);
-      mechs[player].texNormal = glow::Texture2D::createFromData(mechNormalData0.get());
-      mechs[player].texNormal->setObjectLabel(mechNormalFN);
-      mechs[player].texMaterial = glow::Texture2D::createFromData(mechMaterialData0.get());
-      mechs[player].texMaterial->setObjectLabel(mechMaterialFN);
-      mechs[small].texAlbedo = glow::Texture2D::createFromData(mechAlbedoData1.get());
-      mechs[small].texNormal = glow::Texture2D::createFromData(mechNormalData1.get());
-      mechs[small].texMaterial = glow::Texture2D::createFromData(mechMaterialData1.get());
-      mechs[big].texAlbedo = glow::Texture2D::createFromData(mechAlbedoData2.get());
-      mechs[big].texNormal = mechs[small].texNormal;
-      mechs[big].texMaterial = mechs[small].texMaterial;
-
-      for (int i = 0; i <= MAX_HEALTH; i++) {
-        mHealthBar[i] = glow::Texture2D::createFromData(healthBarData[i].get());
-        mHealthBar[i]->setObjectLabel(healthBarFn);
-      }
-      for (int i = 0; i < NUM_ROCKET_TYPES; i++) {
-        mTexRocketAlbedo[i] = glow::Texture2D::createFromData(rocketAlbedoData[i].get());
-        mTexRocketAlbedo[i]->setObjectLabel(rocketFN);
-        mTexRocketNormal[i] = glow::Texture2D::createFromData(rocketNormalData[i].get());
-        mTexRocketNormal[i]->setObjectLabel(rocketFN);
-        mTexRocketMetallic[i] = glow::Texture2D::createFromData(rocketMetallicData[i].get());
-        mTexRocketMetallic[i]->setObjectLabel(rocketFN);
-        mTexRocketRoughness[i] = glow::Texture2D::createFromData(rocketRoughnessData[i].get());
-        mTexRocketRoughness[i]->setObjectLabel(rocketFN);
+      //paths in the pack
+      string texPath = "textures/cooked/";
+      string mechModelFN = "models/mech/mech.fbx";
+
+      // the slowest item, starts first (the pool is fifo)
+      loader.work(mechModelFN, [this, mechModelFN] {
+        auto blob = mPack->get(mechModelFN);
+        if (blob)
+          Mech::mesh = AssimpModel::load(mechModelFN, blob.data, blob.size);
+      });
+      loader.texture(mTexCubeAlbedo, texPath + "cube.albedo.dds", glow::ColorSpace::sRGB);
+      loader.texture(mTexCubeNormal, texPath + "cube.normal.dds", glow::ColorSpace::Linear);
+      loader.texture(mTexCubeMaterial, texPath + "cube.material.dds", glow::ColorSpace::Linear);
+      loader.texture(mSkybox, texPath + "galaxy.dds", glow::ColorSpace::sRGB);
+      for (auto i : {player, small}) { // big shares normal and material with small
+        loader.texture(mechs[i].texAlbedo, texPath + "mech.albedo." + to_string(i) + ".dds", glow::ColorSpace::sRGB);
+        loader.texture(mechs[i].texNormal, texPath + "mech.normal." + to_string(i) + ".dds", glow::ColorSpace::Linear);
+        loader.texture(mechs[i].texMaterial, texPath + "mech.material." + to_string(i) + ".dds", glow::ColorSpace::Linear);
       }
-      mTexPaper = glow::Texture2D::createFromData(paperData.get());
-      mTexPaper->setObjectLabel(paperFN);
+      loader.texture(mHealthBar, texPath + "health.dds", glow::ColorSpace::sRGB);
+      loader.texture(mTexPaper, texPath + "paper.dds", glow::ColorSpace::sRGB);
 
       //mTexDefNormal = glow::Texture2D::createFromFile(texPath + "normal.png", glow::ColorSpace::Linear);
     }
+    //sounds are decoded on the workers too, playback is set up after soloud
+    //straight from the pack, the music streams keep pointing into it
+    {
+      auto load = [&](auto &wav, string const &file) {
+        loader.work(file, [this, &wav, file] {
+          auto blob = mPack->get("sounds/" + file);
+          if (blob)
+            wav.loadMem((unsigned char *)blob.data, (unsigned)blob.size, false, false);
+        });
+      };
+      load(music, "heroic_demise_loop.ogg");
+      load(sfxBootUp, "bootup.wav");
+      load(sfxExpl1, "explosion2.wav");
+      load(sfxExpl2, "explosion2.wav");
+      load(sfxShot, "Shot.wav");
+      load(sfxStep, "FootSteps.wav");
+      //load(sfxLand, "land.wav");
+      load(sfxLand, "FootSteps.wav");
+    }
+    //phase 2: the big mech and all rockets (only the big mech shoots), after everything above
+    {
+      loader.setStage(loadPhase2);
+      string texPath = "textures/cooked/";
+      loader.texture(mechs[big].texAlbedo, texPath + "mech.albedo.2.dds", glow::ColorSpace::sRGB);
+      // one layer per rocket type
+      // the render queue material below needs the objects now, the data comes later
+      mTexRocketAlbedo = glow::Texture2DArray::create();
+      mTexRocketNormal = glow::Texture2DArray::create();
+      mTexRocketMaterial = glow::Texture2DArray::create();
+      loader.texture(mTexRocketAlbedo, texPath + "rocket.albedo.dds", glow::ColorSpace::sRGB);
+      loader.texture(mTexRocketNormal, texPath + "rocket.normal.dds", glow::ColorSpace::Linear);
+      loader.texture(mTexRocketMaterial, texPath + "rocket.material.dds", glow::ColorSpace::Linear);
+      loader.work("spaceBoss.ogg", [this] {
+        auto blob = mPack->get("sounds/spaceBoss.ogg");
+        if (blob)
+          music2.loadMem((unsigned char *)blob.data, (unsigned)blob.size, false, false);
+        music2.setInaudibleBehavior(true, false);
+      });
+      loader.setStage(loadFirstFrame);
+    }
 
     //basic shapes
     mMeshQuad = glow::geometry::make_quad(); // simple procedural quad with vec2 aPosition
-    mMeshSphere = glow::geometry::UVSphere<>(glow::geometry::UVSphere<>::attributesOf(nullptr), 64, 32).generate();
     // cube.obj contains a cube with normals, tangents, and texture coordinates
-    mMeshCube = load_mesh_from_obj("../data/meshes/cube.obj", false /* do not interpolate tangents for cubes */);
-    auto modelMatrices = glow::ArrayBuffer::create();
-    // could be done better with offset I guess
-    modelMatrices->defineAttributes({
-        // mat4, divisor = 1 so each instance new matrix
-        glow::ArrayBufferAttribute(&AttMat::a, "aModel", glow::AttributeMode::Float, 1),  //
-        glow::ArrayBufferAttribute(&AttMat::b, "aModelb", glow::AttributeMode::Float, 1), //
-        glow::ArrayBufferAttribute(&AttMat::c, "aModelc", glow::AttributeMode::Float, 1), //
-        glow::ArrayBufferAttribute(&AttMat::d, "aModeld", glow::AttributeMode::Float, 1)  //
+    // cooked (tools/cook_mesh.cc): 24 shared vertices, 16 bit indices, flat tangents
+    {
+      auto blob = mPack->get("meshes/cooked/cube.mesh");
+      mMeshCube = load_cooked_mesh(blob.data, blob.size, "cube.mesh");
+    }
+    auto cubeInstances = glow::ArrayBuffer::create();
+    cubeInstances->defineAttributes({
+        // divisor = 1 so each instance new data
+        glow::ArrayBufferAttribute(&CubeInstance::posScale, "aPosScale", glow::AttributeMode::Float, 1),     //
+        glow::ArrayBufferAttribute(&CubeInstance::rotation, "aRotation", glow::AttributeMode::Float, 1),     //
+        glow::ArrayBufferAttribute(&CubeInstance::posScale, "aPrevPosScale", glow::AttributeMode::Float, 1), // static, same as now
+        glow::ArrayBufferAttribute(&CubeInstance::rotation, "aPrevRotation", glow::AttributeMode::Float, 1)  //
     });
-    mMeshCube->bind().attach(modelMatrices);
+    mMeshCube->bind().attach(cubeInstances);
+    {
+      // shares vertices with mMeshCube (one interleaved buffer)
+      auto movingInstances = glow::ArrayBuffer::create();
+      movingInstances->defineAttributes({
+          glow::ArrayBufferAttribute(&MovingCubeInstance::posScale, "aPosScale", glow::AttributeMode::Float, 1),         //
+          glow::ArrayBufferAttribute(&MovingCubeInstance::rotation, "aRotation", glow::AttributeMode::Float, 1),         //
+          glow::ArrayBufferAttribute(&MovingCubeInstance::prevPosScale, "aPrevPosScale", glow::AttributeMode::Float, 1), //
+          glow::ArrayBufferAttribute(&MovingCubeInstance::prevRotation, "aPrevRotation", glow::AttributeMode::Float, 1)  //
+      });
+      vector<glow::SharedArrayBuffer> abs = {movingInstances, mMeshCube->getAttributeBuffer("aPosition")};
+      mMeshCubeMoving = glow::VertexArray::create(abs, mMeshCube->getElementArrayBuffer());
+    }
     //other meshes
-    for (int i = 0; i < NUM_ROCKET_TYPES; i++) {
-      mMeshRocket[i] = load_mesh_from_obj("../data/meshes/rocket" + to_string(i) + ".obj", true);
-      auto modelMatrices = glow::ArrayBuffer::create();
-      // could be done better with offset I guess
-      modelMatrices->defineAttributes({
-          // mat4, divisor = 1 so each instance new matrix
-          glow::ArrayBufferAttribute(&AttMat::a, "aModel", glow::AttributeMode::Float, 1),  //
-          glow::ArrayBufferAttribute(&AttMat::b, "aModelb", glow::AttributeMode::Float, 1), //
-          glow::ArrayBufferAttribute(&AttMat::c, "aModelc", glow::AttributeMode::Float, 1), //
-          glow::ArrayBufferAttribute(&AttMat::d, "aModeld", glow::AttributeMode::Float, 1)  //
+    // all rocket types in one vertex array, drawn with one multi-draw (a range and instances per type)
+    {
+      vector<Blob> blobs;
+      vector<pair<char const *, size_t>> meshes;
+      for (int i = 0; i < NUM_ROCKET_TYPES; i++) {
+        blobs.push_back(mPack->get("meshes/cooked/rocket" + to_string(i) + ".mesh"));
+        meshes.push_back({blobs.back().data, blobs.back().size});
+      }
+      vector<MeshRange> ranges;
+      mMeshRocket = load_cooked_meshes(meshes, "rocket meshes", ranges);
+      copy(ranges.begin(), ranges.end(), mRocketRanges);
+      auto rocketInstances = glow::ArrayBuffer::create();
+      rocketInstances->defineAttributes({
+          glow::ArrayBufferAttribute(&RocketInstance::posType, "aPosType", glow::AttributeMode::Float, 1),         //
+          glow::ArrayBufferAttribute(&RocketInstance::velSpin, "aVelSpin", glow::AttributeMode::Float, 1),         //
+          glow::ArrayBufferAttribute(&RocketInstance::prevPosType, "aPrevPosType", glow::AttributeMode::Float, 1), //
+          glow::ArrayBufferAttribute(&RocketInstance::prevVelSpin, "aPrevVelSpin", glow::AttributeMode::Float, 1)  //
       });
-      mMeshRocket[i]->bind().attach(modelMatrices);
+      mMeshRocket->bind().attach(rocketInstances);
+      mRocketCommands = glow::ShaderStorageBuffer::create(NUM_ROCKET_TYPES * sizeof(DrawElementsIndirectCommand));
     }
     //Lines
-    auto abLines = glow::ArrayBuffer::create();
-    abLines->setObjectLabel("Line ab");
-    abLines->defineAttributes({{&LineVertex::pos, "position"}, //
-                               {&LineVertex::color, "color"}});
-    mVALine = glow::VertexArray::create(abLines, GL_LINES);
-    mVALine->setObjectLabel("Line va");
+    mLines = make_unique<LineBuffer>();
+    {
+      // neon: random pairs of sphere points, random colors
+      auto points = spherePoints;
+      random_shuffle(points.begin(), points.end());
+      mt19937_64 rng;
+      uniform_real_distribution<double> unif(0, 1);
+      mNeonLines.resize(points.size() & ~size_t(1));
+      for (size_t i = 0; i < mNeonLines.size(); i++)
+        mNeonLines[i] = {points[i], HSV2RGB(unif(rng), 1, 1)};
+    }
     //Explosion
     {
-      auto abExpl = glow::ArrayBuffer::create();
-      abExpl->setObjectLabel("Explosion ab");
-      abExpl->defineAttributes({{&ExplVertex::pos, "position"}, //
-                                {&ExplVertex::normal, "normal"}});
+      // vertices are pulled from an ssbo by part and gl_VertexID, the instances are the live emitters
       auto sSize = spherePoints.size() - (spherePoints.size() % 3);
-      vector<ExplVertex> ver(sSize);
+      vector<glm::vec4> ver(sSize * 2); // position, normal
       for (int i = 0; i < sSize; i += 3) {
-        ver[i].pos = spherePoints[i];
-        ver[i + 1].pos = spherePoints[i + 1];
-        ver[i + 2].pos = spherePoints[i + 2];
-        auto n = normalize(cross(ver[i + 1].pos - ver[i].pos, ver[i + 2].pos - ver[i].pos));
-        ver[i].normal = n;
-        ver[i + 1].normal = n;
-        ver[i + 2].normal = n;
+        auto n = normalize(cross(spherePoints[i + 1] - spherePoints[i], spherePoints[i + 2] - spherePoints[i]));
+        for (int j = i; j < i + 3; j++) {
+          ver[j * 2] = glm::vec4(spherePoints[j], 1);
+          ver[j * 2 + 1] = glm::vec4(n, 0);
+        }
       }
-      abExpl->bind().setData(ver);
+      mSSBOExplosionVertices = glow::ShaderStorageBuffer::create(ver);
+      mSSBOExplosions = glow::ShaderStorageBuffer::create(vector<Explosion>(MAX_EXPLOSIONS));
+      mSSBOExplosionCommands = glow::ShaderStorageBuffer::create(sizeof(DrawArraysIndirectCommand));
+
+      auto abExpl = glow::ArrayBuffer::create();
+      abExpl->setObjectLabel("Explosion instances");
+      abExpl->defineAttribute<glm::vec4>("aPosAge", glow::AttributeMode::Float, 1);
+      abExpl->bind().setData(MAX_EXPLOSIONS * sizeof(glm::vec4));
       mVAExplosion = glow::VertexArray::create(abExpl, GL_TRIANGLES);
       mVAExplosion->setObjectLabel("Explosion va");
     }
@@ -353,15 +391,211 @@ void Game::init() {
 
 
     //shader
-    mShaderCube = glow::Program::createFromFile("../data/shaders/cube");
-    mShaderCubePrepass = glow::Program::createFromFile("../data/shaders/cube.pre");
+    // all compile concurrently, binaries of unchanged programs are loaded from the cache instead
+    glow::Program::setBinaryCacheDirectory("../shadercache");
+    glow::Program::beginParallelCompilation();
+    mShaderCube = mVariantsCube.get();
+    mShaderCubeDepth = mVariantsCube.get({"DEPTH_ONLY"});
+    mShaderRocket = mVariantsRocket.get({"TEXTURE_ARRAY"});
+    mShaderRocketDepth = mVariantsRocket.get({"DEPTH_ONLY"});
     mShaderOutput = glow::Program::createFromFile("../data/shaders/output");
-    mShaderMode = glow::Program::createFromFile("../data/shaders/mode");
-    mShaderMech = glow::Program::createFromFile("../data/shaders/mech");
+    mShaderMech = mVariantsMech.get();
+    mShaderMechDepth = mVariantsMech.get({"DEPTH_ONLY"});
     mShaderUI = glow::Program::createFromFile("../data/shaders/ui");
-    mShaderFuse = glow::Program::createFromFile("../data/shaders/fuse");
+    // specialized per mode, mixed tiles use the generic one
+    const char *modeNames[] = {"normal", "neon", "drawn", "disco"}; // Mode order
+    for (auto i = 0; i < FUSE_MIXED; ++i)
+      mShaderFuse[i] = glow::Program::createFromFile("../data/shaders/fuse." + std::string(modeNames[i]));
+    mShaderFuse[FUSE_MIXED] = glow::Program::createFromFile("../data/shaders/fuse");
+    mShaderClassify = glow::Program::createFromFile("../data/shaders/classify.csh");
     mShaderLine = glow::Program::createFromFile("../data/shaders/line");
-    mShaderExplosion = glow::Program::createFromFile("../data/shaders/explosion");
+    mShaderExplosion = mVariantsExplosion.get();
+    mShaderExplosionDepth = mVariantsExplosion.get({"DEPTH_ONLY"});
+    mShaderExplosionSim = glow::Program::createFromFile("../data/shaders/explosion.csh");
+    mShaderCluster = glow::Program::createFromFile("../data/shaders/cluster.csh");
+    mShaderLight = glow::Program::createFromFiles({"../data/shaders/screen.vsh", "../data/shaders/light.fsh"});
+    mShaderTAA = glow::Program::createFromFiles({"../data/shaders/screen.vsh", "../data/shaders/taa.fsh"});
+    mShaderHiZ = glow::Program::createFromFile("../data/shaders/hiz.csh");
+    mShaderCull = glow::Program::createFromFile("../data/shaders/cull.csh");
+    auto shaderBRDF = glow::Program::createFromFile("../data/shaders/brdf.csh"); // only used below
+    bulletDebugger = make_unique<BulletDebugger>(*mLines); // once, not per phase
+    loader.wait(loadFirstFrame); // uploads, while the driver compiles
+    mechs[big].texNormal = mechs[small].texNormal;
+    mechs[big].texMaterial = mechs[small].texMaterial;
+    glow::Program::finishParallelCompilation();
+
+    //uniform blocks
+    mUBFrame = glow::UniformBuffer::create();
+    mUBFrame->setObjectLabel("FrameBlock");
+    mUBFrame->addVerification({{&FrameData::shadowViewProj, "uShadowViewProj"},
+                               {&FrameData::shadowViewProjNear, "uShadowViewProjNear"},
+                               {&FrameData::lightPos, "uLightPos"},
+                               {&FrameData::time, "uTime"},
+                               {&FrameData::skyFactor, "uSkyFactor"},
+                               {&FrameData::texShadowSize, "uTexShadowSize"},
+                               {&FrameData::modeAreaCount, "uModeAreaCount"},
+                               {&FrameData::lightCount, "uLightCount"},
+                               {&FrameData::modeAreas, "uModeAreas[0]"},
+                               {&FrameData::modeAreaModes, "uModeAreaModes[0]"},
+                               {&FrameData::camViewProj, "uCamViewProj"},
+                               {&FrameData::prevCamViewProj, "uPrevCamViewProj"}});
+    mUBFrame->bind().setData(FrameData(), GL_STREAM_DRAW);
+    mUBView = glow::UniformBuffer::create();
+    mUBView->setObjectLabel("ViewBlock");
+    mUBView->addVerification({{&ViewData::proj, "uProj"},
+                              {&ViewData::view, "uView"},
+                              {&ViewData::invProj, "uInvProj"},
+                              {&ViewData::invView, "uInvView"},
+                              {&ViewData::camPos, "uCamPos"},
+                              {&ViewData::zNear, "uZNear"},
+                              {&ViewData::zFar, "uZFar"}});
+    mUBView->bind().setData(ViewData(), GL_STREAM_DRAW);
+    for (auto const &p : {mShaderCube, mShaderCubeDepth, mShaderRocket, mShaderRocketDepth, mShaderMech, mShaderMechDepth, mShaderLine, mShaderExplosion, mShaderExplosionDepth, mShaderCluster, mShaderLight, mShaderTAA, mShaderCull}) {
+      p->setUniformBuffer("FrameBlock", mUBFrame);
+      p->setUniformBuffer("ViewBlock", mUBView);
+    }
+    for (auto const &p : mShaderFuse) {
+      p->setUniformBuffer("FrameBlock", mUBFrame);
+      p->setUniformBuffer("ViewBlock", mUBView);
+    }
+
+    //uniform handles
+    mCubeUniforms.albedo = mShaderCube->texture("uTexAlbedo");
+    mCubeUniforms.normal = mShaderCube->texture("uTexNormal");
+    mCubeUniforms.material = mShaderCube->texture("uTexMaterial");
+    mRocketUniforms.albedo = mShaderRocket->texture("uTexAlbedo");
+    mRocketUniforms.normal = mShaderRocket->texture("uTexNormal");
+    mRocketUniforms.material = mShaderRocket->texture("uTexMaterial");
+    mMechUniforms.blink = mShaderMech->uniform<bool>("uBlink");
+    mMechUniforms.model = mShaderMech->uniform<glm::mat4>("uModel");
+    mMechUniforms.bones = mShaderMech->uniform<glm::mat4>("uBones[0]"); // really, uBones[0] instead of uBones...
+    mMechUniforms.prevModel = mShaderMech->uniform<glm::mat4>("uPrevModel");
+    mMechUniforms.prevBones = mShaderMech->uniform<glm::mat4>("uPrevBones[0]");
+    mMechUniforms.albedo = mShaderMech->texture("uTexAlbedo");
+    mMechUniforms.normal = mShaderMech->texture("uTexNormal");
+    mMechUniforms.material = mShaderMech->texture("uTexMaterial");
+    mMechDepthUniforms.model = mShaderMechDepth->uniform<glm::mat4>("uModel");
+    mMechDepthUniforms.bones = mShaderMechDepth->uniform<glm::mat4>("uBones[0]");
+    for (auto i = 0; i < FUSE_CLASSES; ++i) {
+      auto &u = mFuseUniforms[i];
+      auto &p = mShaderFuse[i];
+      u.color = p->texture("uTexColor");
+      u.normal = p->texture("uTexNormal");
+      u.material = p->texture("uTexMaterial");
+      u.depth = p->texture("uTexDepth");
+      u.skybox = p->texture("uSkybox");
+      u.brdf = p->texture("uTexBRDF");
+      u.paper = p->texture("uTexPaper");
+      u.shadow = p->texture("uTexShadow");
+      u.shadowNear = p->texture("uTexShadowNear");
+      u.light = p->texture("uTexLight");
+      u.tileClass = p->uniform<int32_t>("uTileClass");
+      u.tileCapacity = p->uniform<int32_t>("uTileCapacity");
+      u.screenSize = p->uniform<glm::vec2>("uScreenSize");
+    }
+    //split sum lookup for the reflections, the same every frame
+    {
+      mTexBRDF = glow::Texture2D::createStorageImmutable(64, 64, GL_RG16F, 1);
+      auto tex = mTexBRDF->bind();
+      tex.setWrap(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+      tex.setMinFilter(GL_LINEAR);
+      tex.setMagFilter(GL_LINEAR);
+      auto shader = shaderBRDF->use();
+      shader.setImage(0, mTexBRDF, GL_WRITE_ONLY, 0);
+      shader.compute(64 / 8, 64 / 8);
+      glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+    mClassifyUniforms.depth = mShaderClassify->texture("uTexDepth");
+    mClassifyUniforms.tileCapacity = mShaderClassify->uniform<int32_t>("uTileCapacity");
+    mClassifyUniforms.screenSize = mShaderClassify->uniform<glm::vec2>("uScreenSize");
+    mUIUniforms.health = mShaderUI->texture("uTexHealth");
+    mUIUniforms.model = mShaderUI->uniform<glm::mat4>("uModel");
+    mUIUniforms.layer = mShaderUI->uniform<int32_t>("uLayer");
+    mOutputUniforms.color = mShaderOutput->texture("uTexColor");
+    mOutputUniforms.resolution = mShaderOutput->uniform<glm::vec2>("uResolution");
+    mOutputUniforms.uvScale = mShaderOutput->uniform<glm::vec2>("uUVScale");
+    mOutputUniforms.fxaa = mShaderOutput->uniform<bool>("uFXAA");
+    mTAAUniforms.color = mShaderTAA->texture("uTexColor");
+    mTAAUniforms.history = mShaderTAA->texture("uTexHistory");
+    mTAAUniforms.velocity = mShaderTAA->texture("uTexVelocity");
+    mTAAUniforms.depth = mShaderTAA->texture("uTexDepth");
+    mTAAUniforms.historyUVScale = mShaderTAA->uniform<glm::vec2>("uHistoryUVScale");
+    mTAAUniforms.historyWeight = mShaderTAA->uniform<float>("uHistoryWeight");
+    mTAAUniforms.renderSize = mShaderTAA->uniform<glm::ivec2>("uRenderSize");
+    mOutputUniforms.subpix = mShaderOutput->uniform<float>("ufxaaQualitySubpix");
+    mOutputUniforms.edgeThreshold = mShaderOutput->uniform<float>("ufxaaQualityEdgeThreshold");
+    mOutputUniforms.edgeThresholdMin = mShaderOutput->uniform<float>("ufxaaQualityEdgeThresholdMin");
+    mClusterUniforms.clusterCount = mShaderCluster->uniform<glm::ivec3>("uClusterCount");
+    mClusterUniforms.indexCapacity = mShaderCluster->uniform<int32_t>("uIndexCapacity");
+    mClusterUniforms.screenSize = mShaderCluster->uniform<glm::vec2>("uScreenSize");
+    mLightUniforms.clusterCount = mShaderLight->uniform<glm::ivec3>("uClusterCount");
+    mLightUniforms.normal = mShaderLight->texture("uTexNormal");
+    mLightUniforms.depth = mShaderLight->texture("uTexDepth");
+
+    //clustered lights, sized in onResize
+    mSSBOLights = glow::ShaderStorageBuffer::create(MAX_LIGHTS * sizeof(PointLight));
+    mSSBOClusters = glow::ShaderStorageBuffer::create();
+    mSSBOClusterIndices = glow::ShaderStorageBuffer::create();
+    mSSBOClusterCounter = glow::ShaderStorageBuffer::create(sizeof(uint32_t));
+    for (auto const &p : {mShaderCluster, mShaderLight}) {
+      p->setShaderStorageBuffer("LightBuffer", mSSBOLights);
+      p->setShaderStorageBuffer("ClusterBuffer", mSSBOClusters);
+      p->setShaderStorageBuffer("ClusterIndexBuffer", mSSBOClusterIndices);
+    }
+    mShaderCluster->setShaderStorageBuffer("ClusterCounterBuffer", mSSBOClusterCounter);
+
+    //fuse tiles, sized in onResize
+    mSSBOFuseTiles = glow::ShaderStorageBuffer::create();
+    mSSBOFuseCommands = glow::ShaderStorageBuffer::create(FUSE_CLASSES * sizeof(DrawArraysIndirectCommand));
+    mShaderClassify->setShaderStorageBuffer("FuseTileBuffer", mSSBOFuseTiles);
+    mShaderClassify->setShaderStorageBuffer("FuseCommandBuffer", mSSBOFuseCommands);
+    for (auto const &p : mShaderFuse)
+      p->setShaderStorageBuffer("FuseTileBuffer", mSSBOFuseTiles);
+
+    //explosion particles
+    for (auto const &p : {mShaderExplosion, mShaderExplosionDepth})
+      p->setShaderStorageBuffer("ExplosionVertexBuffer", mSSBOExplosionVertices);
+    mShaderExplosionSim->setShaderStorageBuffer("ExplosionBuffer", mSSBOExplosions);
+    mShaderExplosionSim->setShaderStorageBuffer("ExplosionInstanceBuffer", glow::ShaderStorageBuffer::createAliased(mVAExplosion->getAttributeBuffer("aPosAge")));
+    mShaderExplosionSim->setShaderStorageBuffer("ExplosionCommandBuffer", mSSBOExplosionCommands);
+    mExplosionSimClock = mShaderExplosionSim->uniform<float>("uClock");
+
+    //occlusion culling, pyramids are created in onResize
+    mHiZUniforms.depth = mShaderHiZ->texture("uTexDepth");
+    mHiZUniforms.level = mShaderHiZ->uniform<int32_t>("uLevel");
+    mHiZUniforms.srcSize = mShaderHiZ->uniform<glm::ivec2>("uSrcSize");
+    mCullUniforms.hiz = mShaderCull->texture("uTexHiZ");
+    mCullUniforms.hizScreenSize = mShaderCull->uniform<glm::ivec2>("uHiZScreenSize");
+    mCullUniforms.hizValid = mShaderCull->uniform<bool>("uHiZValid");
+    mCullUniforms.late = mShaderCull->uniform<bool>("uLate");
+    mCullUniforms.scaleInW = mShaderCull->uniform<bool>("uScaleInW");
+    mCullUniforms.count = mShaderCull->uniform<int32_t>("uCount");
+    mCullUniforms.stride = mShaderCull->uniform<int32_t>("uStride");
+    mCullUniforms.draws = mShaderCull->uniform<int32_t>("uDraws");
+    mCullUniforms.radius = mShaderCull->uniform<float>("uRadius");
+    mCullCube = createCullGroup(mMeshCube, "aPosScale", glm::sqrt(3.f), true); // cube.obj has size 2
+    mCullCubeMoving = createCullGroup(mMeshCubeMoving, "aPosScale", glm::sqrt(3.f), true);
+    // of the obj files (1.1, .6, 1.9), forward is scaled by .5 in instance.glsl, the largest for all types
+    mCullRocket = createCullGroup(mMeshRocket, "aPosType", 1.9f, false, {mRocketRanges, mRocketRanges + NUM_ROCKET_TYPES});
+    for (auto &g : mCullMech)
+      g = createCullGroup(Mech::mesh->getVA(), "", 1, true); // one instance, the bounding sphere
+
+    //render queue
+    mQueueProgram.cube = mQueue.addProgram(mShaderCube);
+    mQueueProgram.cubeDepth = mQueue.addProgram(mShaderCubeDepth);
+    mQueueProgram.rocket = mQueue.addProgram(mShaderRocket);
+    mQueueProgram.rocketDepth = mQueue.addProgram(mShaderRocketDepth);
+    mQueueProgram.mech = mQueue.addProgram(mShaderMech);
+    mQueueProgram.mechDepth = mQueue.addProgram(mShaderMechDepth);
+    mQueueProgram.line = mQueue.addProgram(mShaderLine);
+    mQueueProgram.explosion = mQueue.addProgram(mShaderExplosion);
+    mQueueProgram.explosionDepth = mQueue.addProgram(mShaderExplosionDepth);
+    mMaterialCube = mQueue.addMaterial(mQueueProgram.cube, {{mCubeUniforms.albedo, mTexCubeAlbedo},
+                                                            {mCubeUniforms.normal, mTexCubeNormal},
+                                                            {mCubeUniforms.material, mTexCubeMaterial}});
+    mMaterialRocket = mQueue.addMaterial(mQueueProgram.rocket, {{mRocketUniforms.albedo, mTexRocketAlbedo},
+                                                                {mRocketUniforms.normal, mTexRocketNormal},
+                                                                {mRocketUniforms.material, mTexRocketMaterial}});
   }
 
   // Sound
@@ -383,28 +617,18 @@ void Game::init() {
     soloud->setMaxActiveVoiceCount(255);
     //sounds
     {
-      const string snddir = "../data/sounds/";
-      music.load((snddir + "heroic_demise_loop.ogg").c_str());
+      //loaded by the loader above
       music.setInaudibleBehavior(true, false);
-      music2.load((snddir + "spaceBoss.ogg").c_str());
-      music2.setInaudibleBehavior(true, false);
       //placeholder
-      sfxBootUp.load((snddir + "bootup.wav").c_str());
       sfxBootUp.mVolume = .8;
       sfxBootUp.setInaudibleBehavior(true, false);
-      sfxExpl1.load((snddir + "explosion2.wav").c_str());
       sfxExpl1.mVolume = .7;
       sfxExpl1.setInaudibleBehavior(false, true);
-      sfxExpl2.load((snddir + "explosion2.wav").c_str());
       sfxExpl2.mVolume = .7;
       sfxExpl1.setInaudibleBehavior(false, true);
-      sfxShot.load((snddir + "Shot.wav").c_str());
       sfxShot.setInaudibleBehavior(false, true);
-      sfxStep.load((snddir + "FootSteps.wav").c_str());
       sfxStep.mVolume = .3;
       sfxStep.setInaudibleBehavior(false, true);
-      //sfxLand.load((snddir + "land.wav").c_str());
-      sfxLand.load((snddir + "FootSteps.wav").c_str());
       sfxLand.setInaudibleBehavior(false, true);
 
       intro.setText("You put your mind into a machine? I will have you know your emotions are hackable now.");
@@ -444,7 +668,6 @@ void Game::initPhaseBoth() {
   {
     dynamicsWorld = make_unique<btDiscreteDynamicsWorld>(dispatcher.get(), overlappingPairCache.get(), solver.get(), collisionConfiguration.get());
     dynamicsWorld->setGravity(btVector3(0, -9.81, 0));
-    bulletDebugger = make_unique<BulletDebugger>();
     dynamicsWorld->setDebugDrawer(bulletDebugger.get());
     dynamicsWorld->setInternalTickCallback(bulletCallbackStatic);
   }
@@ -586,6 +809,7 @@ void Game::initPhase1() {
 }
 
 void Game::initPhase2() {
+  mLoader->wait(loadPhase2); // streamed in during phase 1, usually long done
   initPhaseBoth();
   secondPhase = true;
   mechs[small].setAction(Mech::emptyAction);
@@ -684,6 +908,9 @@ entityx::Entity Game::createCube(const glm::ivec3 &pos, bool moves) {
     // const auto des = set<int>{25,24,15,14,5,4};
   }
 
+  if (!moves)
+    mStaticDirty = true;
+
   auto entity = ex.entities.create();
   entity.assign<SharedbtRigidBody>(rbCube);
   entity.assign<defMotionState>(motionState);
@@ -799,14 +1026,12 @@ void Game::update(float) {
             soloud->play3d(sfxExpl1, pos.x, pos.y, pos.z);
           else
             soloud->play3d(sfxExpl2, pos.x, pos.y, pos.z);
-          explosions.push_back(Explosion{pos, 0});
+          addExplosion(pos);
           //boom
           for (const auto &point : spherePoints) {
             auto from = btcast(pos);
             auto to = btcast(pos + (point * 1.5)); //1.5m radius
-#ifndef NDEBUG
-            dynamicsWorld->getDebugDrawer()->drawLine(from, to, btVector4(1, 0, 0, 1));
-#endif
+            mLines->line(LineBuffer::Probes, pos, pos + (point * 1.5), {1, 0, 0});
             auto closest = btCollisionWorld::ClosestRayResultCallback(from, to);
             dynamicsWorld->rayTest(from, to, closest);
             if (closest.hasHit()) {
@@ -831,6 +1056,7 @@ void Game::update(float) {
                 dynamicsWorld->removeRigidBody(body);
                 createCube(c->pos, true);
                 entity.destroy();
+                mStaticDirty = true;
               }
             }
           }
@@ -918,21 +1144,83 @@ void Game::update(float) {
 //*************************************
 // todo: safe normals from one frame and use those for light for some time -> similar to afterimage
 
+// light space bounds of shadow receivers, xy on the plane at distance 1 from the (perspective) light
+struct LightBounds {
+  glm::vec2 min = glm::vec2(numeric_limits<float>::max());
+  glm::vec2 max = glm::vec2(-numeric_limits<float>::max());
+  float zNear = numeric_limits<float>::max();
+  float zFar = 0;
+
+  LightBounds(const glm::mat4 &lightView, const vector<glm::vec3> &points) {
+    for (auto const &p : points) {
+      auto v = glm::vec3(lightView * glm::vec4(p, 1));
+      auto d = glm::max(-v.z, .1f);
+      min = glm::min(min, glm::vec2(v) / d);
+      max = glm::max(max, glm::vec2(v) / d);
+      zNear = glm::min(zNear, d);
+      zFar = glm::max(zFar, d);
+    }
+  }
+
+  LightBounds intersect(const LightBounds &o) const {
+    auto r = *this;
+    r.min = glm::max(min, o.min);
+    r.max = glm::min(max, o.max);
+    r.zNear = glm::max(zNear, o.zNear);
+    r.zFar = glm::min(zFar, o.zFar);
+    if (r.min.x >= r.max.x || r.min.y >= r.max.y || r.zNear >= r.zFar)
+      return o; // looking away from it
+    return r;
+  }
+
+  // stabilized: size only changes in steps and the origin snaps to texels -> edges don't swim when the fit moves
+  glm::mat4 projection(int mapSize) const {
+    auto extent = glm::max(max.x - min.x, max.y - min.y);
+    auto size = (glm::ceil(extent * 64) + 1) / 64;
+    auto texel = size / mapSize;
+    auto lo = glm::floor(min / texel) * texel;
+    auto n = glm::max(glm::floor(zNear * 2) / 2 - .5f, .1f);
+    auto f = glm::ceil(zFar * 2) / 2 + .5f;
+    return glm::frustum(lo.x * n, (lo.x + size) * n, lo.y * n, (lo.y + size) * n, n, f);
+  }
+};
+
+// everything that can receive a shadow: floor, pillars, mechs
+static vector<glm::vec3> arenaCorners() {
+  vector<glm::vec3> corners;
+  for (auto x : {CUBES_MIN - .5f, CUBES_MAX + .5f})
+    for (auto y : {-1.f, 12.f})
+      for (auto z : {CUBES_MIN - .5f, CUBES_MAX + .5f})
+        corners.push_back({x, y, z});
+  return corners;
+}
+
+// world space corners of the camera frustum between the distances from and to
+static vector<glm::vec3> frustumCorners(const glm::mat4 &proj, const glm::mat4 &view, float from, float to) {
+  auto invProj = glm::inverse(proj);
+  auto invView = glm::inverse(view);
+  vector<glm::vec3> corners;
+  for (auto x : {-1.f, 1.f})
+    for (auto y : {-1.f, 1.f}) {
+      auto p = invProj * glm::vec4(x, y, -1, 1);
+      auto dir = glm::vec3(p) / -p.z; // at distance 1
+      for (auto d : {from, to})
+        corners.push_back(glm::vec3(invView * glm::vec4(dir * d, 1)));
+    }
+  return corners;
+}
+
 void Game::render(float elapsedSeconds) {
   // render game variable timestep
   drawTime += elapsedSeconds;
 
   // Change display settings
-  if (mCurrentSSAAFactor != mSSAAFactor) {
-    onResize(getWindowWidth(), getWindowHeight());
-    glow::log(glow::LogLevel::Info) << "SSAA: " << to_string(mCurrentSSAAFactor);
-  }
-  if (mCurrentShadowFactor != mShadowFactor) {
-    mShadowMapSize = mMaxShadowSize / mShadowFactor;
-    mCurrentShadowFactor = mShadowFactor;
-    mBufferShadow->bind().resize(mShadowMapSize, mShadowMapSize);
-    glow::log(glow::LogLevel::Info) << "Shadows: " << to_string(mShadowMapSize) << "^2";
-  }
+  updateRenderScale();
+  if (mCurrentShadowBudgetMB != mShadowBudgetMB)
+    resizeShadows();
+
+  // phase 2 assets, a couple of uploads per frame
+  mLoader->poll(std::chrono::milliseconds(1));
 
   //dynamicsWorld->stepSimulation( elapsedSeconds); // I want
 
@@ -943,57 +1231,177 @@ void Game::render(float elapsedSeconds) {
   // get camera matrices
   auto proj = mCamera->getProjectionMatrix();
   auto view = mCamera->getViewMatrix();
+  // TAA: subpixel offset per frame, halton(2, 3) -> evenly spread over 8 frames
+  // only the camera passes use the jittered projection, velocities and shadows are without
+  auto taa = mAAMode != aaFXAA;
+  auto jitteredProj = proj;
+  if (taa) {
+    auto halton = [](int i, int base) {
+      float f = 1, r = 0;
+      for (; i > 0; i /= base) {
+        f /= base;
+        r += f * (i % base);
+      }
+      return r;
+    };
+    mJitterIndex = mJitterIndex % 8 + 1;
+    auto jitter = (glm::vec2(halton(mJitterIndex, 2), halton(mJitterIndex, 3)) - .5f) * 2.f / glm::vec2(mRenderSize);
+    jitteredProj[2][0] -= jitter.x;
+    jitteredProj[2][1] -= jitter.y;
+  }
   // from glow-samples
-  //change parameters!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!1
-  glm::mat4 shadowProj = glm::perspective(glm::pi<float>() / 5.0f, 1.0f, 80.0f, 105.0f);
+  // two shadow cascades, both tightly fitted around the receivers:
+  // the whole arena (static casters cached) and the part of the arena near the camera
   glm::mat4 shadowView = glm::lookAt(mLightPos, glm::vec3(0.0f), glm::vec3(1, 0, 0));
+  glm::mat4 shadowProj, shadowProjNear;
+  {
+    auto arena = LightBounds(shadowView, arenaCorners());
+    shadowProj = arena.projection(mShadowMapSize);
+    auto nearCorners = frustumCorners(proj, view, mCamera->getNearClippingPlane(), mShadowSplit);
+    shadowProjNear = LightBounds(shadowView, nearCorners).intersect(arena).projection(mShadowMapSize);
+  }
+  if (shadowProj != mShadowProjStatic) {
+    mShadowProjStatic = shadowProj;
+    mStaticDirty = true;
+  }
   glm::mat4 shadowViewProj = shadowProj * shadowView;
 
+  updateExplosions(elapsedSeconds); // before the lights
+
+  // per-frame uniforms, once
+  {
+    FrameData frame;
+    frame.shadowViewProj = shadowViewProj;
+    frame.shadowViewProjNear = shadowProjNear * shadowView;
+    frame.lightPos = mLightPos;
+    frame.time = drawTime;
+    frame.skyFactor = secondPhase ? 1.f : .1f;
+    frame.texShadowSize = (float)mShadowMapSize;
+    // mode areas, evaluated per pixel in fuse and per cube in instance.glsl
+    int areas = 0;
+    glm::ivec4 areaModes[MAX_MODE_AREAS / 4] = {};
+    auto area = entityx::ComponentHandle<ModeArea>();
+    for (auto entity : ex.entities.entities_with_components(area))
+      if (areas < MAX_MODE_AREAS) {
+        frame.modeAreas[areas] = glm::vec4(area->pos, area->radius);
+        areaModes[areas / 4][areas % 4] = area->mode;
+        areas++;
+      }
+    for (auto i = 0; i < MAX_MODE_AREAS / 4; ++i)
+      frame.modeAreaModes[i] = areaModes[i];
+    frame.modeAreaCount = areas;
+    uploadLights();
+    frame.lightCount = mLightCount;
+    frame.camViewProj = proj * view;
+    frame.prevCamViewProj = mHistoryValid ? mPrevCamViewProj : proj * view;
+    mPrevCamViewProj = proj * view;
+    mUBFrame->bind().setData(frame, GL_STREAM_DRAW);
+  }
+
   //update animations
   for (auto &m : mechs) {
+    m.newFrame();
     auto t1 = m.animationsTime[1];
     m.updateTime(elapsedSeconds);
     m.didStep = m.mesh->MechdidStep(t1, m.animationsTime[1]);
   }
 
 
+  // all draws of the frame, instance data is uploaded once for all passes
+  uploadCubes();
+  uploadRockets();
+  fillQueue(glm::vec3(glm::inverse(view)[3]));
+
   // Shadow
   {
-    auto fb = mFramebufferShadow->bind();
-    glClear(GL_DEPTH_BUFFER_BIT);
     GLOW_SCOPED(enable, GL_DEPTH_TEST);
     GLOW_SCOPED(enable, GL_CULL_FACE);
     //GLOW_SCOPED(cullFace, GL_FRONT); // bad idea for my cubes
     GLOW_SCOPED(depthFunc, GL_LESS);
+    GLOW_SCOPED(enable, GL_DEPTH_CLAMP); // projections only fit the receivers, casters above get flattened onto the near plane
+    setView(shadowProj, shadowView);
+
+    // light never moves, so floor and pillars only change when destroyed
+    if (mStaticDirty) {
+      auto fb = mFramebufferShadowStatic->bind();
+      glClear(GL_DEPTH_BUFFER_BIT);
+      mQueue.submit(passShadowStatic);
+      mStaticDirty = false;
+    }
+
+    auto fb = mFramebufferShadow->bind();
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, mFramebufferShadowStatic->getObjectName());
+    glBlitFramebuffer(0, 0, mShadowMapSize, mShadowMapSize, 0, 0, mShadowMapSize, mShadowMapSize, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, mFramebufferShadow->getObjectName());
+    mQueue.submit(passShadow);
+  }
+  {
+    GLOW_SCOPED(enable, GL_DEPTH_TEST);
+    GLOW_SCOPED(enable, GL_CULL_FACE);
+    GLOW_SCOPED(depthFunc, GL_LESS);
+    GLOW_SCOPED(enable, GL_DEPTH_CLAMP);
+    setView(shadowProjNear, shadowView);
 
-    drawCubes(mShaderCubePrepass->use(), shadowProj, shadowView);
-    drawRockets(mShaderCubePrepass->use(), shadowProj, shadowView);
-    drawMech(mShaderMech->use(), shadowProj, shadowView);
-    drawExplosion(mShaderExplosion->use(), shadowProj, shadowView, elapsedSeconds);
+    auto fb = mFramebufferShadowNear->bind();
+    glClear(GL_DEPTH_BUFFER_BIT);
+    mQueue.submit(passShadowNear);
+  }
+
+  // camera for all following passes
+  setView(jitteredProj, view);
+
+  // light list per cluster, only needs the camera
+  {
+    mSSBOClusterCounter->bind().setData(uint32_t(0), GL_STREAM_DRAW);
+    auto shader = mShaderCluster->use();
+    shader.setUniform(mClusterUniforms.clusterCount, mClusterCount);
+    shader.setUniform(mClusterUniforms.indexCapacity, mClusterCapacity * CLUSTER_AVG_LIGHTS);
+    shader.setUniform(mClusterUniforms.screenSize, glm::vec2(mRenderSize));
+    shader.compute((mClusterCount.x + 7) / 8, (mClusterCount.y + 7) / 8, mClusterCount.z);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
   }
 
+  // occlusion culling, early: what was visible in last frame's pyramid
+  for (auto m = 0; m < 3; ++m)
+    mCullMech[m].instances->bind().setData(mechs[m].getBoundingSphere(), GL_STREAM_DRAW);
+  auto cullAll = [this](bool late) {
+    cull(mCullCube, {mCubeCount}, late);
+    cull(mCullCubeMoving, {mCubeMovingCount}, late);
+    cull(mCullRocket, {mRocketCount, mRocketCount + NUM_ROCKET_TYPES}, late);
+    for (auto &g : mCullMech)
+      cull(g, {1}, late);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+  };
+  cullAll(false);
+
   // Depth
   {
-    auto fb = mFramebufferMode->bind();
+    auto fb = mFramebufferDepth->bind();
+    GLOW_SCOPED(viewport, 0, 0, mRenderSize.x, mRenderSize.y);
     GLOW_SCOPED(enable, GL_DEPTH_TEST);
     GLOW_SCOPED(enable, GL_CULL_FACE);
     GLOW_SCOPED(clearColor, glm::vec3(0, 0, 0));
     glClear(GL_DEPTH_BUFFER_BIT);
 
-    drawCubes(mShaderCubePrepass->use(), proj, view);
-    drawRockets(mShaderCubePrepass->use(), proj, view);
-    //drawMech(mShaderMech->use(), proj, view);
-    drawExplosion(mShaderExplosion->use(), proj, view);
+    mQueue.submit(passDepth);
+
+    // late: everything against the new pyramid, adds what early missed
+    buildHiZ();
+    cullAll(true);
+    mQueue.submit(passDepthLate);
+
     if (mDebugBullet) {
       dynamicsWorld->debugDrawWorld();
-      bulletDebugger->draw(proj * view);
+      bulletDebugger->draw(proj * view, LineBuffer::Physics | LineBuffer::Probes);
     }
   }
 
   // GBuffer
   {
     auto fb = mFramebufferGBuffer->bind();
+    GLOW_SCOPED(viewport, 0, 0, mRenderSize.x, mRenderSize.y);
     // glViewport is automatically set by framebuffer
+    GLOW_SCOPED(enable, GL_FRAMEBUFFER_SRGB); // albedo is stored as sRGB
     GLOW_SCOPED(enable, GL_DEPTH_TEST);
     GLOW_SCOPED(enable, GL_CULL_FACE);
     GLOW_SCOPED(depthMask, GL_FALSE);
@@ -1002,308 +1410,561 @@ void Game::render(float elapsedSeconds) {
     GLOW_SCOPED(clearColor, glm::vec3(0, 0, 0));
     glClear(GL_COLOR_BUFFER_BIT);
 
-    drawCubes(mShaderCube->use(), proj, view);
-    drawRockets(mShaderCube->use(), proj, view);
-    drawExplosion(mShaderExplosion->use(), proj, view);
+    mQueue.submit(passGBuffer);
     {
       GLOW_SCOPED(enable, GL_CULL_FACE);
       GLOW_SCOPED(depthMask, GL_TRUE);
       GLOW_SCOPED(depthFunc, GL_LESS);
-      drawMech(mShaderMech->use(), proj, view);
-      drawLines(mShaderLine->use(), proj, view);
+      mQueue.submit(passGBufferForward);
       // Render Bullet Debug
       if (mDebugBullet) {
         GLOW_SCOPED(disable, GL_DEPTH_TEST);
-        bulletDebugger->draw(proj * view);
+        bulletDebugger->draw(proj * view, LineBuffer::Physics | LineBuffer::Probes);
       }
     }
   }
 
-  // Mode
+  // Light
+  // clustered: each pixel only loops over the lights of its cluster
   {
-    auto fb = mFramebufferMode->bind();
-    glClear(GL_COLOR_BUFFER_BIT);
-    GLOW_SCOPED(enable, GL_CULL_FACE);
-    GLOW_SCOPED(enable, GL_DEPTH_TEST);
-    GLOW_SCOPED(depthMask, GL_FALSE); // Disable depth write
-    GLOW_SCOPED(enable, GL_BLEND);
-    GLOW_SCOPED(blendEquation, GL_MAX); // priority
-    GLOW_SCOPED(cullFace, GL_FRONT);    // write backfaces
-    GLOW_SCOPED(depthFunc, GL_GREATER); // Inverse z test
-
-    auto shader = mShaderMode->use();
-    auto sphere = mMeshSphere->bind();
-    auto areaHandle = entityx::ComponentHandle<ModeArea>();
-    auto areaEntities = ex.entities.entities_with_components(areaHandle);
-    for (auto entity : areaEntities) {
-      auto r = areaHandle->radius;
-      shader.setTexture("uTexDepth", mGBufferDepth);
-      shader.setUniform("uPos", areaHandle->pos);
-      shader.setUniform("uPVM", proj * view * glm::translate(areaHandle->pos) * glm::scale(glm::vec3(r, r, r)));
-      shader.setUniform("uInvProj", glm::inverse(proj));
-      shader.setUniform("uInvView", glm::inverse(view));
-      shader.setUniform("uRadius", r);
-      auto modeID = (int32_t)areaHandle->mode;
-      shader.setUniform("uMode", modeID);
-      sphere.draw();
-    }
+    auto fb = mFramebufferLight->bind();
+    GLOW_SCOPED(viewport, 0, 0, mRenderSize.x, mRenderSize.y);
+    GLOW_SCOPED(disable, GL_DEPTH_TEST);
+    GLOW_SCOPED(disable, GL_CULL_FACE);
+    auto shader = mShaderLight->use();
+    shader.setUniform(mLightUniforms.clusterCount, mClusterCount);
+    shader.setTexture(mLightUniforms.normal, mGBufferNormal);
+    shader.setTexture(mLightUniforms.depth, mGBufferDepth);
+    mMeshQuad->bind().draw();
   }
 
-
-  // Light
-  /*
-    {
-        auto fb = mFramebufferLight->bind();
-        // partly from RTGLive
-        GLOW_SCOPED(enable, GL_CULL_FACE);
-        GLOW_SCOPED(enable, GL_DEPTH_TEST);
-        GLOW_SCOPED(depthMask, GL_FALSE); // Disable depth write
-
-        GLOW_SCOPED(clearColor, glm::vec3(0, 0, 0));
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        // todo actuall lights
-        {
-            GLOW_SCOPED(enable, GL_BLEND);
-            GLOW_SCOPED(blendFunc, GL_ONE, GL_ONE);
-            GLOW_SCOPED(cullFace, GL_FRONT);    // write backfaces
-            GLOW_SCOPED(depthFunc, GL_GREATER); // Inverse z test
-        }
-    }
-    */
-
   //screen space:
   {
     GLOW_SCOPED(disable, GL_DEPTH_TEST);
     GLOW_SCOPED(disable, GL_CULL_FACE);
-    //fuse
+    //sort the tiles by their modes, so most of them run a shader without the mode branches
+    auto tileCount = (mRenderSize + FUSE_TILE - 1) / FUSE_TILE;
+    {
+      std::vector<DrawArraysIndirectCommand> commands(FUSE_CLASSES, {4 /* quad vertices */, 0, 0, 0});
+      mSSBOFuseCommands->bind().setData(commands, GL_STREAM_DRAW);
+      auto shader = mShaderClassify->use();
+      shader.setTexture(mClassifyUniforms.depth, mGBufferDepth);
+      shader.setUniform(mClassifyUniforms.tileCapacity, mFuseTileCapacity);
+      shader.setUniform(mClassifyUniforms.screenSize, glm::vec2(mRenderSize));
+      shader.compute(tileCount.x, tileCount.y);
+      glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+    }
+    //fuse, one instanced draw of tile quads per class
     {
       auto fb = mFramebufferFuse->bind();
-      auto shader = mShaderFuse->use();
-      shader.setTexture("uTexColor", mGBufferAlbedo);
-      shader.setTexture("uTexNormal", mGBufferNormal);
-      shader.setTexture("uTexMaterial", mGBufferMaterial);
-      shader.setTexture("uTexDepth", mGBufferDepth);
-      shader.setTexture("uTexMode", mBufferMode);
-      shader.setTexture("uSkybox", mSkybox);
-      shader.setTexture("uTexPaper", mTexPaper);
-      shader.setUniform("uView", view);
-      shader.setUniform("uInvProj", inverse(proj));
-      shader.setUniform("uInvView", inverse(view));
-      shader.setUniform("uZNear", mCamera->getNearClippingPlane());
-      shader.setUniform("uZFar", mCamera->getFarClippingPlane());
-      shader.setUniform("uCamPos", mCamera->getPosition());
-      shader.setUniform("uTime", drawTime);
-      shader.setUniform("uSkyFactor", (secondPhase ? 1.f : .1f));
-      //from glow samples
-      shader.setUniform("uLightPos", mLightPos);
-      shader.setUniform("uTexShadowSize", (float)mShadowMapSize);
-      shader.setUniform("uShadowViewProjMatrix", shadowViewProj);
-      shader.setTexture("uTexShadow", mBufferShadow);
+      GLOW_SCOPED(viewport, 0, 0, mRenderSize.x, mRenderSize.y);
+      auto quad = mMeshQuad->bind();
+      for (auto i = 0; i < FUSE_CLASSES; ++i) {
+        auto &u = mFuseUniforms[i];
+        auto shader = mShaderFuse[i]->use();
+        shader.setTexture(u.color, mGBufferAlbedo);
+        shader.setTexture(u.normal, mGBufferNormal);
+        shader.setTexture(u.material, mGBufferMaterial);
+        shader.setTexture(u.depth, mGBufferDepth);
+        shader.setTexture(u.skybox, mSkybox);
+        shader.setTexture(u.brdf, mTexBRDF);
+        shader.setTexture(u.paper, mTexPaper);
+        //from glow samples
+        shader.setTexture(u.shadow, mBufferShadow);
+        shader.setTexture(u.shadowNear, mBufferShadowNear);
+        shader.setTexture(u.light, mBufferLight);
+        shader.setUniform(u.tileClass, i);
+        shader.setUniform(u.tileCapacity, mFuseTileCapacity);
+        shader.setUniform(u.screenSize, glm::vec2(mRenderSize));
+        quad.drawIndirect(mSSBOFuseCommands, i * sizeof(DrawArraysIndirectCommand));
+      }
+    }
+    // TAA, blend into the history of the last frame
+    if (taa) {
+      auto fb = mFramebufferHistory[mHistoryIndex]->bind();
+      GLOW_SCOPED(viewport, 0, 0, mRenderSize.x, mRenderSize.y);
+      auto &history = mBufferHistory[1 - mHistoryIndex];
+      auto shader = mShaderTAA->use();
+      shader.setTexture(mTAAUniforms.color, mBufferFuse);
+      shader.setTexture(mTAAUniforms.history, history);
+      shader.setTexture(mTAAUniforms.velocity, mGBufferVelocity);
+      shader.setTexture(mTAAUniforms.depth, mGBufferDepth);
+      shader.setUniform(mTAAUniforms.historyUVScale, glm::vec2(mHistorySize) / glm::vec2(history->getWidth(), history->getHeight()));
+      shader.setUniform(mTAAUniforms.historyWeight, mHistoryValid ? .9f : 0.f);
+      shader.setUniform(mTAAUniforms.renderSize, mRenderSize);
       mMeshQuad->bind().draw();
     }
     // draw ui // after fxaa too pixely...
-    {
+    // with TAA after the output, it must not end up in the history
+    auto drawUI = [&] {
       auto health = mechs[player].HP;
       if (health >= 0 && health <= MAX_HEALTH) {
-        auto fb = mFramebufferFuse->bind();
         auto shader = mShaderUI->use();
-        shader.setTexture("uTexHealth", mHealthBar[health]);
+        shader.setTexture(mUIUniforms.health, mHealthBar);
+        shader.setUniform(mUIUniforms.layer, health);
         auto model = glm::scale(glm::translate(glm::mat4(), glm::vec3(-.87, -.87, 0)), glm::vec3(.1, .1, 1));
-        shader.setUniform("uModel", model);
+        shader.setUniform(mUIUniforms.model, model);
         mMeshQuad->bind().draw();
       }
+    };
+    if (!taa) {
+      auto fb = mFramebufferFuse->bind();
+      GLOW_SCOPED(viewport, 0, 0, mRenderSize.x, mRenderSize.y);
+      drawUI();
     }
     // render framebuffer content to output with small post-processing effect
     {
       // draw a fullscreen quad for outputting the framebuffer and applying a post-process
+      auto &color = taa ? mBufferHistory[mHistoryIndex] : mBufferFuse;
       auto shader = mShaderOutput->use();
-      shader.setTexture("uTexColor", mBufferFuse);
-      shader.setUniform("uResolution", glm::vec2(mBufferFuse->getWidth(), mBufferFuse->getHeight()));
-      shader.setUniform("ufxaaQualitySubpix", fxaaQualitySubpix);
-      shader.setUniform("ufxaaQualityEdgeThreshold", fxaaQualityEdgeThreshold);
-      shader.setUniform("ufxaaQualityEdgeThresholdMin", fxaaQualityEdgeThresholdMin);
+      shader.setTexture(mOutputUniforms.color, color);
+      shader.setUniform(mOutputUniforms.resolution, glm::vec2(color->getWidth(), color->getHeight()));
+      shader.setUniform(mOutputUniforms.uvScale, glm::vec2(mRenderSize) / glm::vec2(color->getWidth(), color->getHeight()));
+      shader.setUniform(mOutputUniforms.fxaa, mAAMode != aaTAA);
+      shader.setUniform(mOutputUniforms.subpix, fxaaQualitySubpix);
+      shader.setUniform(mOutputUniforms.edgeThreshold, fxaaQualityEdgeThreshold);
+      shader.setUniform(mOutputUniforms.edgeThresholdMin, fxaaQualityEdgeThresholdMin);
       mMeshQuad->bind().draw();
     }
+    if (taa)
+      drawUI();
   }
-
-  bulletDebugger->clearLines();
+  // next frame reads what was written now
+  mHiZIndex = 1 - mHiZIndex;
+  mHiZValid = true;
+  mHistoryValid = taa;
+  mHistoryIndex = 1 - mHistoryIndex;
+  mHistorySize = mRenderSize;
+
+  mFrameTimers[mFrameTimerIndex]->end();
+  mFrameTimerStarted[mFrameTimerIndex] = true;
+  mFrameTimerIndex = (mFrameTimerIndex + 1) % 4;
+
+  mLines->nextFrame();
+  mLines->mask = LineBuffer::Neon | (mDebugBullet ? LineBuffer::Physics | LineBuffer::Probes : 0);
 }
 
-void Game::drawMech(glow::UsedProgram shader, glm::mat4 proj, glm::mat4 view) {
-  shader.setUniform("uProj", proj);
-  shader.setUniform("uView", view);
-  //shader.setTexture("uTexMode", mBufferMode);
-  mechs[player].draw(shader);
-  if (!fin) { // fix odd bug?
-    if (!secondPhase)
-      mechs[small].draw(shader);
-    else
-      mechs[big].draw(shader);
+void Game::updateRenderScale() {
+  // oldest timer, started 3 frames ago
+  auto &timer = mFrameTimers[mFrameTimerIndex];
+  if (!timer)
+    timer = glow::TimerQuery::create();
+  if (mFrameTimerStarted[mFrameTimerIndex] && timer->isResultAvailable()) {
+    auto ms = float(timer->getResult64() / 1e6);
+    mGpuFrameMS = mGpuFrameMS == 0 ? ms : glm::mix(mGpuFrameMS, ms, .1f);
   }
-}
 
-void Game::drawCubes(glow::UsedProgram shader, glm::mat4 proj, glm::mat4 view) {
-  shader.setUniform("uProj", proj);
-  shader.setUniform("uView", view);
+  auto scale = mRenderScale;
+  if (mSSAAFactor > 0)
+    scale = mSSAAFactor;
+  else if (mGpuFrameMS > 0) {
+    // cost grows with the pixel count, move a bit towards the target each frame
+    auto wanted = mRenderScale * glm::sqrt(mTargetFrameMS / mGpuFrameMS);
+    if (glm::abs(wanted - mRenderScale) > .02f * mRenderScale) // don't chase noise
+      scale = glm::clamp(wanted, mRenderScale * .95f, mRenderScale * 1.05f);
+  }
+  mRenderScale = glm::clamp(scale, MIN_RENDER_SCALE, MAX_RENDER_SCALE);
 
-  shader.setTexture("uTexAlbedo", mTexCubeAlbedo);
-  shader.setTexture("uTexNormal", mTexCubeNormal);
-  shader.setTexture("uTexMetallic", mTexCubeMetallic);
-  shader.setTexture("uTexRoughness", mTexCubeRoughness);
+  // same aspect as the window, never more than allocated
+  mRenderSize = glm::clamp(glm::ivec2(glm::vec2(mWindowSize) * mRenderScale + .5f), glm::ivec2(1), glm::ivec2(mGBufferDepth->getWidth(), mGBufferDepth->getHeight()));
+  mClusterCount = {(mRenderSize.x + CLUSTER_TILE - 1) / CLUSTER_TILE, (mRenderSize.y + CLUSTER_TILE - 1) / CLUSTER_TILE, CLUSTER_SLICES};
 
-  // model matrices
-  vector<glm::mat4> models;
-  models.reserve(3000);
-  auto cubeHandle = entityx::ComponentHandle<Cube>();
-  auto cubeEntities = ex.entities.entities_with_components(cubeHandle);
+  mFrameTimers[mFrameTimerIndex]->begin();
+}
 
-  vector<ModeArea> scaleAreas;
-  {
-    auto area = entityx::ComponentHandle<ModeArea>();
-    for (auto entity : ex.entities.entities_with_components(area))
-      if (area->mode == drawn)
-        scaleAreas.push_back(*area.get());
+CullGroup Game::createCullGroup(glow::SharedVertexArray const &mesh, std::string const &instanceAttribute, float radius, bool scaleInW,
+                                std::vector<MeshRange> ranges) {
+  CullGroup g;
+  // the culled commands are indexed, meshes without indices (e.g. plain triangle lists) get 0, 1, 2, ...
+  auto eab = mesh->getElementArrayBuffer();
+  if (!eab) {
+    vector<uint32_t> indices(mesh->getVertexCount());
+    iota(indices.begin(), indices.end(), 0u);
+    eab = glow::ElementArrayBuffer::create(indices);
   }
-
-
-  for (entityx::Entity entity : cubeEntities) {
-    glm::mat4x4 modelCube;
-    {
-      auto motionState = *entity.component<defMotionState>().get();
-      btTransform trans;
-      motionState->getWorldTransform(trans);
-      static_assert(sizeof(AttMat) == sizeof(glm::mat4x4), "bwah");
-      trans.getOpenGLMatrix(glm::value_ptr(modelCube));
+  if (ranges.empty()) {
+    ranges.resize(1);
+    ranges[0].indexCount = eab->getIndexCount();
+  }
+  g.ranges = move(ranges);
+  g.radius = radius;
+  g.scaleInW = scaleInW;
+  g.commands = glow::ShaderStorageBuffer::create(3 * g.ranges.size() * sizeof(DrawElementsIndirectCommand));
+  g.earlyVisible = glow::ShaderStorageBuffer::create();
+
+  if (instanceAttribute.empty()) {
+    // not instanced, only the commands are used
+    g.instances = glow::ShaderStorageBuffer::create(sizeof(glm::vec4));
+    auto indexed = mesh;
+    if (eab != mesh->getElementArrayBuffer()) {
+      vector<glow::SharedArrayBuffer> abs;
+      for (auto const &a : mesh->getAttributes())
+        if (find(abs.begin(), abs.end(), a.buffer) == abs.end())
+          abs.push_back(a.buffer);
+      indexed = glow::VertexArray::create(abs, eab, mesh->getPrimitiveMode());
     }
-    modelCube = glm::scale(modelCube, glm::vec3(0.5)); // cube.obj has size 2, +0001 to close gaps -> they are no gaps but z fighting
-    //scale down in a mode
-    {
-      auto trans = translation(modelCube);
-      for (const auto &area : scaleAreas) {
-        auto distanceFactor = (glm::distance(area.pos, trans) / area.radius);
-        if (distanceFactor < 1)
-          modelCube = glm::scale(modelCube, glm::vec3(0.95));
-      }
+    for (auto i = 0; i < 3; ++i) {
+      g.lists[i] = glow::ShaderStorageBuffer::create(sizeof(glm::vec4));
+      g.meshes[i] = indexed;
     }
-    models.push_back(modelCube);
+    return g;
   }
 
-  auto abModels = mMeshCube->getAttributeBuffer("aModel");
-  assert(abModels);
-  abModels->bind().setData(models);
-  mMeshCube->bind().draw(models.size());
+  // same vertices, one instance buffer per list
+  auto instances = mesh->getAttributeBuffer(instanceAttribute);
+  g.instances = glow::ShaderStorageBuffer::createAliased(instances);
+  g.stride = instances->getStride() / sizeof(glm::vec4);
+  for (auto i = 0; i < 3; ++i) {
+    auto list = glow::ArrayBuffer::create(instances->getAttributes());
+    vector<glow::SharedArrayBuffer> abs = {list};
+    for (auto const &a : mesh->getAttributes())
+      if (a.buffer != instances && find(abs.begin(), abs.end(), a.buffer) == abs.end())
+        abs.push_back(a.buffer);
+    g.lists[i] = glow::ShaderStorageBuffer::createAliased(list);
+    g.meshes[i] = glow::VertexArray::create(abs, eab, mesh->getPrimitiveMode());
+  }
+  return g;
 }
 
-void Game::drawRockets(glow::UsedProgram shader, glm::mat4 proj, glm::mat4 view) {
-  shader.setUniform("uProj", proj);
-  shader.setUniform("uView", view);
-  //shader.setTexture("uTexMode", mBufferMode);
+void Game::buildHiZ() {
+  auto &hiz = mHiZ[mHiZIndex];
+  auto shader = mShaderHiZ->use();
+  shader.setTexture(mHiZUniforms.depth, mGBufferDepth);
+  auto srcSize = mRenderSize;
+  for (auto level = 0; level < HIZ_LEVELS; ++level) {
+    auto dstSize = (srcSize + 1) / 2;
+    shader.setUniform(mHiZUniforms.level, level);
+    shader.setUniform(mHiZUniforms.srcSize, srcSize);
+    if (level > 0)
+      shader.setImage(0, hiz, GL_READ_ONLY, level - 1);
+    shader.setImage(1, hiz, GL_WRITE_ONLY, level);
+    shader.compute((dstSize.x + 7) / 8, (dstSize.y + 7) / 8);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    srcSize = dstSize;
+  }
+  glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+  mHiZSize[mHiZIndex] = mRenderSize;
+}
 
-  // model matrices
-  vector<glm::mat4> models[NUM_ROCKET_TYPES];
-  for (int i = 0; i < NUM_ROCKET_TYPES; i++)
-    models[i].reserve(1000);
+void Game::cull(CullGroup &g, std::vector<int> const &counts, bool late) {
+  // the instances of a range go to the same place in every list, so baseInstance is their first
+  auto count = 0;
+  vector<DrawElementsIndirectCommand> commands(3 * g.ranges.size());
+  for (size_t r = 0; r < g.ranges.size(); ++r) {
+    for (auto list = 0; list < 3; ++list)
+      commands[list * g.ranges.size() + r] = {g.ranges[r].indexCount, 0, g.ranges[r].firstIndex, g.ranges[r].baseVertex, (uint32_t)count};
+    count += counts[r];
+  }
+  if (!late)
+    g.commands->bind().setData(commands, GL_STREAM_DRAW);
+  if (count == 0)
+    return;
+
+  if (count > g.capacity) {
+    g.capacity = count + count / 2;
+    for (auto const &l : g.lists)
+      l->bind().reserve(g.capacity * g.stride * sizeof(glm::vec4), GL_DYNAMIC_COPY);
+    g.earlyVisible->bind().reserve(g.capacity * sizeof(uint32_t), GL_DYNAMIC_COPY);
+  }
 
-  auto RocketHandle = entityx::ComponentHandle<Rocket>();
-  auto Entities = ex.entities.entities_with_components(RocketHandle);
+  // early tests against last frame's pyramid
+  auto hiz = late ? mHiZIndex : 1 - mHiZIndex;
+  mShaderCull->setShaderStorageBuffer("CullCommandBuffer", g.commands);
+  mShaderCull->setShaderStorageBuffer("CullInstanceBuffer", g.instances);
+  mShaderCull->setShaderStorageBuffer("CullEarlyBuffer", g.lists[cullEarly]);
+  mShaderCull->setShaderStorageBuffer("CullLateBuffer", g.lists[cullLate]);
+  mShaderCull->setShaderStorageBuffer("CullVisibleBuffer", g.lists[cullVisible]);
+  mShaderCull->setShaderStorageBuffer("CullEarlyVisibleBuffer", g.earlyVisible);
+  auto shader = mShaderCull->use();
+  shader.setTexture(mCullUniforms.hiz, mHiZ[hiz]);
+  shader.setUniform(mCullUniforms.hizScreenSize, mHiZSize[hiz]);
+  shader.setUniform(mCullUniforms.hizValid, late || mHiZValid);
+  shader.setUniform(mCullUniforms.late, late);
+  shader.setUniform(mCullUniforms.count, count);
+  shader.setUniform(mCullUniforms.stride, g.stride);
+  shader.setUniform(mCullUniforms.draws, (int32_t)g.ranges.size());
+  shader.setUniform(mCullUniforms.radius, g.radius);
+  shader.setUniform(mCullUniforms.scaleInW, g.scaleInW);
+  shader.compute((count + 63) / 64);
+}
 
-  for (entityx::Entity entity : Entities) {
-    glm::mat4x4 model;
-    {
-      auto motionState = *entity.component<defMotionState>().get();
-      btTransform trans;
-      motionState->getWorldTransform(trans);
-      trans.getOpenGLMatrix(glm::value_ptr(model));
-    }
-    auto rigid = *entity.component<SharedbtRigidBody>().get();
-    switch (RocketHandle->type) {
-    case rtype::forward:
-      model = glm::scale(model, glm::vec3(.5));
-      break;
-    case rtype::falling:
-      model = rotate(model, glm::vec3(0, 0, 1), glm::vec3(0, -1, 0));
-    default:;
+void Game::resizeShadows() {
+  // three maps (static, arena, near) with 16 bit depth, biggest power of two in the budget
+  auto bytes = [](size_t size) { return 3 * 2 * size * size; };
+  mShadowMapSize = 512;
+  while (mShadowMapSize * 2 <= mMaxShadowSize && bytes(mShadowMapSize * 2) <= ((size_t)mShadowBudgetMB << 20))
+    mShadowMapSize *= 2;
+  mCurrentShadowBudgetMB = mShadowBudgetMB;
+
+  for (auto const &t : {mBufferShadow, mBufferShadowStatic, mBufferShadowNear})
+    t->bind().resize(mShadowMapSize, mShadowMapSize);
+  mStaticDirty = true;
+  glow::log(glow::LogLevel::Info) << "Shadows: " << to_string(mShadowMapSize) << "^2, " << to_string(bytes(mShadowMapSize) >> 20) << " MB";
+}
+
+void Game::setView(glm::mat4 proj, glm::mat4 view) {
+  auto invView = glm::inverse(view);
+  ViewData v;
+  v.proj = proj;
+  v.view = view;
+  v.invProj = glm::inverse(proj);
+  v.invView = invView;
+  v.camPos = glm::vec3(invView[3]);
+  v.zNear = mCamera->getNearClippingPlane();
+  v.zFar = mCamera->getFarClippingPlane();
+  mUBView->bind().setData(v, GL_STREAM_DRAW);
+}
+
+void Game::uploadCubes() {
+  // static ones only if they changed
+  vector<CubeInstance> instances;
+  vector<MovingCubeInstance> moving;
+  if (mStaticDirty)
+    instances.reserve(3000);
+  auto cubeHandle = entityx::ComponentHandle<Cube>();
+  for (entityx::Entity entity : ex.entities.entities_with_components(cubeHandle)) {
+    if (!cubeHandle->moves && !mStaticDirty)
+      continue;
+    auto motionState = *entity.component<defMotionState>().get();
+    btTransform trans;
+    motionState->getWorldTransform(trans);
+    auto rot = trans.getRotation();
+    // cube.obj has size 2, +0001 to close gaps -> they are no gaps but z fighting
+    // shrinking in drawn areas happens in the shader
+    auto posScale = glm::vec4(glcast(trans.getOrigin()), .5f);
+    auto rotation = glm::vec4(rot.x(), rot.y(), rot.z(), rot.w());
+    if (!cubeHandle->moves) {
+      instances.push_back({posScale, rotation});
+      continue;
     }
-    if (RocketHandle->type != rtype::homing)
-      model = rotate(model, glm::normalize(glcast(rigid->getLinearVelocity())));
+    MovingCubeInstance i;
+    i.posScale = posScale;
+    i.rotation = rotation;
+    i.prevPosScale = cubeHandle->drawn ? cubeHandle->prevPosScale : posScale;
+    i.prevRotation = cubeHandle->drawn ? cubeHandle->prevRotation : rotation;
+    cubeHandle->prevPosScale = posScale;
+    cubeHandle->prevRotation = rotation;
+    cubeHandle->drawn = true;
+    moving.push_back(i);
+  }
 
+  if (mStaticDirty) {
+    auto ab = mMeshCube->getAttributeBuffer("aPosScale");
+    assert(ab);
+    ab->bind().setData(instances);
+    mCubeCount = instances.size();
+  }
+  mMeshCubeMoving->getAttributeBuffer("aPosScale")->bind().setData(moving);
+  mCubeMovingCount = moving.size();
+}
 
-    models[(int)(RocketHandle->type)].push_back(model);
+void Game::uploadRockets() {
+  vector<RocketInstance> instances[NUM_ROCKET_TYPES];
+  for (int i = 0; i < NUM_ROCKET_TYPES; i++)
+    instances[i].reserve(1000);
+
+  auto RocketHandle = entityx::ComponentHandle<Rocket>();
+  for (entityx::Entity entity : ex.entities.entities_with_components(RocketHandle)) {
+    auto motionState = *entity.component<defMotionState>().get();
+    btTransform trans;
+    motionState->getWorldTransform(trans);
+    auto rigid = *entity.component<SharedbtRigidBody>().get();
+    auto type = RocketHandle->type;
+    // orientation from velocity is done in the shader
+    // falling ones only spin around y, homing ones are steered by angular velocity -> full rotation
+    auto rot = trans.getRotation();
+    glm::vec4 velSpin;
+    if (type == rtype::homing)
+      velSpin = glm::vec4(rot.x(), rot.y(), rot.z(), rot.w());
+    else
+      velSpin = glm::vec4(glcast(rigid->getLinearVelocity()), type == rtype::falling ? 2 * atan2(rot.y(), rot.w()) : 0);
+    RocketInstance i;
+    i.posType = glm::vec4(glcast(trans.getOrigin()), (float)type);
+    i.velSpin = velSpin;
+    i.prevPosType = RocketHandle->drawn ? RocketHandle->prevPosType : i.posType;
+    i.prevVelSpin = RocketHandle->drawn ? RocketHandle->prevVelSpin : i.velSpin;
+    RocketHandle->prevPosType = i.posType;
+    RocketHandle->prevVelSpin = i.velSpin;
+    RocketHandle->drawn = true;
+    instances[(int)type].push_back(i);
   }
 
+  // one buffer sorted by type, a draw per type starts at its first instance
+  vector<RocketInstance> all;
+  DrawElementsIndirectCommand commands[NUM_ROCKET_TYPES];
   for (int i = 0; i < NUM_ROCKET_TYPES; i++) {
-    shader.setTexture("uTexAlbedo", mTexRocketAlbedo[i]);
-    shader.setTexture("uTexNormal", mTexRocketNormal[i]);
-    shader.setTexture("uTexMetallic", mTexRocketMetallic[i]);
-    shader.setTexture("uTexRoughness", mTexRocketRoughness[i]);
-
-    auto abModels = mMeshRocket[i]->getAttributeBuffer("aModel");
-    assert(abModels);
-    abModels->bind().setData(models[i]);
-    mMeshRocket[i]->bind().draw(models[i].size());
+    auto const &r = mRocketRanges[i];
+    commands[i] = {r.indexCount, (uint32_t)instances[i].size(), r.firstIndex, r.baseVertex, (uint32_t)all.size()};
+    all.insert(all.end(), instances[i].begin(), instances[i].end());
+    mRocketCount[i] = instances[i].size();
   }
+  auto ab = mMeshRocket->getAttributeBuffer("aPosType");
+  assert(ab);
+  ab->bind().setData(all);
+  mRocketCommands->bind().setData(commands, GL_STREAM_DRAW);
 }
 
-glm::vec3 HSV2RGB(float h, float s, float v) {
-  //based on:
-  //https://stackoverflow.com/questions/3018313/algorithm-to-convert-rgb-to-hsv-and-hsv-to-rgb-in-range-0-255-for-both
-  auto rgb = saturate(glm::vec3(abs(h * 6 - 3) - 1, //
-                                2 - abs(h * 6 - 2), //
-                                2 - abs(h * 6 - 4)));
+void Game::uploadLights() {
+  vector<PointLight> lights;
+  lights.reserve(256);
 
-  return glm::vec3(((rgb - glm::vec3(1.)) * s + glm::vec3(1.)) * v);
+  // rockets glow a bit
+  const glm::vec3 rocketColors[NUM_ROCKET_TYPES] = {{1, .5, .2}, {1, .15, .1}, {.3, .5, 1}};
+  auto RocketHandle = entityx::ComponentHandle<Rocket>();
+  for (entityx::Entity entity : ex.entities.entities_with_components(RocketHandle)) {
+    if (lights.size() >= MAX_LIGHTS)
+      break;
+    auto motionState = *entity.component<defMotionState>().get();
+    btTransform trans;
+    motionState->getWorldTransform(trans);
+    lights.push_back({glm::vec4(glcast(trans.getOrigin()), 4), glm::vec4(rocketColors[(int)RocketHandle->type] * 3.f, 1)});
+  }
+
+  // explosions flash and fade
+  for (auto const &e : mExplosions) {
+    auto age = mExplosionClock - e.birth;
+    if (age < 0 || age > EXPLOSION_TIME)
+      continue;
+    if (lights.size() >= MAX_LIGHTS)
+      break;
+    auto fade = glm::max(0.f, 1 - age / EXPLOSION_TIME);
+    lights.push_back({glm::vec4(e.pos, 8), glm::vec4(glm::vec3(1, .6, .3) * 20.f * fade, 1)});
+  }
+
+  mLightCount = lights.size();
+  if (!lights.empty())
+    mSSBOLights->bind().setData(lights, GL_STREAM_DRAW);
 }
 
-void Game::drawLines(glow::UsedProgram shader, glm::mat4 proj, glm::mat4 view) {
-  auto ab = mVALine->getAttributeBuffer("position");
-  static bool init = false;
-  if (!init) {
-    vector<LineVertex> lines(spherePoints.size());
-    random_shuffle(spherePoints.begin(), spherePoints.end());
-    static mt19937_64 rng;
-    uniform_real_distribution<double> unif(0, 1);
-    for (int i = 0; i < spherePoints.size(); i += 2) {
-      lines[i] = LineVertex({spherePoints[i], HSV2RGB(unif(rng), 1, 1)});
-      lines[i + 1] = LineVertex({spherePoints[i + 1], HSV2RGB(unif(rng), 1, 1)});
-    }
-    ab->bind().setData(lines);
-    init = true;
+void Game::addExplosion(glm::vec3 pos) {
+  // overwrites the oldest, long dead unless there are more than MAX_EXPLOSIONS in EXPLOSION_TIME
+  mExplosions[mExplosionHead] = {pos, mExplosionClock};
+  mExplosionHead = (mExplosionHead + 1) % MAX_EXPLOSIONS;
+  mExplosionNew = glm::min(mExplosionNew + 1, MAX_EXPLOSIONS);
+  mExplosionLastBirth = mExplosionClock;
+}
+
+void Game::updateExplosions(float dT) {
+  mExplosionClock += dT;
+
+  // the clock is a float, as on the GPU, restart it before it loses precision
+  // births move with it, so ages stay the same, the whole ring is uploaded again
+  if (mExplosionClock > EXPLOSION_CLOCK_WRAP) {
+    auto shift = mExplosionClock;
+    mExplosionClock = 0;
+    mExplosionLastBirth -= shift;
+    for (auto &e : mExplosions)
+      e.birth -= shift;
+    mExplosionNew = MAX_EXPLOSIONS;
   }
 
-  // TODO rotate around center...
-  auto area = entityx::ComponentHandle<ModeArea>();
-  for (auto entity : ex.entities.entities_with_components(area))
-    if (area->mode == neon) {
-      auto a = *area.get();
-      auto model = glm::translate(glm::mat4(), a.pos);
-      model = scale(model, glm::vec3(a.radius));
-      shader.setUniform("uProjViewModel", proj * view * model);
-      mVALine->bind().draw(500 / max(30 - (int)a.radius, 1)); // bigger -> more lines (in 30 steps)
+  // new emitters, at most two ranges of the ring
+  if (mExplosionNew > 0) {
+    auto first = (mExplosionHead - mExplosionNew + MAX_EXPLOSIONS) % MAX_EXPLOSIONS;
+    auto ssbo = mSSBOExplosions->bind();
+    auto upload = [&](int from, int count) { ssbo.setSubData(from * sizeof(Explosion), count * sizeof(Explosion), &mExplosions[from]); };
+    if (first + mExplosionNew <= MAX_EXPLOSIONS)
+      upload(first, mExplosionNew);
+    else {
+      upload(first, MAX_EXPLOSIONS - first);
+      upload(0, first + mExplosionNew - MAX_EXPLOSIONS);
     }
+    mExplosionNew = 0;
+  }
+  if (mExplosionClock - mExplosionLastBirth > EXPLOSION_TIME)
+    return; // all dead, nothing to draw
+
+  // live emitters -> instances
+  // the vertex count is set by the shader, from explosion.glsl
+  mSSBOExplosionCommands->bind().setData(DrawArraysIndirectCommand{0, 0, 0, 0}, GL_STREAM_DRAW);
+  auto shader = mShaderExplosionSim->use();
+  shader.setUniform(mExplosionSimClock, mExplosionClock);
+  shader.compute(MAX_EXPLOSIONS / 64);
+  glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
 }
 
-void Game::drawExplosion(glow::UsedProgram shader, glm::mat4 proj, glm::mat4 view, float dT) {
-  const auto explosionTime = .3;
-  const auto explosionParts = 8;
-  const auto explosionRadius = 1.;
-  list<Explosion> keepList;
-  while (!explosions.empty()) {
-    Explosion e = explosions.back();
-    explosions.pop_back();
-    e.time += dT;
-    if (e.time > explosionTime)
-      continue;
-    int part = min((int)((e.time * explosionParts) / explosionTime), 7);
-    auto model = glm::translate(glm::mat4(), e.pos);
-    auto r = explosionRadius * e.time / explosionTime;
-    model = scale(model, glm::vec3(r));
-    shader.setUniform("uProjView", proj * view);
-    shader.setUniform("uModel", model);
-    mVAExplosion->bind().drawRange(part * 60, part * 60 + 59);
-    keepList.push_back(e);
+void Game::fillQueue(glm::vec3 camPos) {
+  mQueue.clear();
+
+  // camera passes draw the occlusion culled lists, the instance counts come from cull.csh
+  auto pushCulled = [this](uint8_t program, uint8_t programDepth, uint16_t material, CullGroup &g) {
+    auto push = [&](uint8_t pass, uint8_t p, uint16_t m, CullList list) {
+      auto draw = [&g, list](glow::UsedProgram &, glow::BoundVertexArray &va) {
+        va.multiDrawIndirect(g.commands, g.ranges.size(), list * g.ranges.size() * sizeof(DrawElementsIndirectCommand));
+      };
+      mQueue.push(pass, p, m, 0, g.meshes[list].get(), draw);
+    };
+    push(passDepth, programDepth, RenderQueue::noMaterial, cullEarly);
+    push(passDepthLate, programDepth, RenderQueue::noMaterial, cullLate);
+    push(passGBuffer, program, material, cullVisible);
+  };
+
+  // instanced, depth does not matter
+  if (mCubeCount > 0) {
+    auto draw = [this](glow::UsedProgram &, glow::BoundVertexArray &va) { va.draw(mCubeCount); };
+    if (mStaticDirty)
+      mQueue.push(passShadowStatic, mQueueProgram.cubeDepth, RenderQueue::noMaterial, 0, mMeshCube.get(), draw);
+    mQueue.push(passShadowNear, mQueueProgram.cubeDepth, RenderQueue::noMaterial, 0, mMeshCube.get(), draw);
+    pushCulled(mQueueProgram.cube, mQueueProgram.cubeDepth, mMaterialCube, mCullCube);
+  }
+  if (mCubeMovingCount > 0) {
+    auto draw = [this](glow::UsedProgram &, glow::BoundVertexArray &va) { va.draw(mCubeMovingCount); };
+    mQueue.push(passShadow, mQueueProgram.cubeDepth, RenderQueue::noMaterial, 0, mMeshCubeMoving.get(), draw);
+    mQueue.push(passShadowNear, mQueueProgram.cubeDepth, RenderQueue::noMaterial, 0, mMeshCubeMoving.get(), draw);
+    pushCulled(mQueueProgram.cube, mQueueProgram.cubeDepth, mMaterialCube, mCullCubeMoving);
   }
-  explosions = keepList;
+  // all types in one multi-draw, the layer of the texture arrays is the type (aPosType.w)
+  if (accumulate(mRocketCount, mRocketCount + NUM_ROCKET_TYPES, 0) > 0) {
+    auto draw = [this](glow::UsedProgram &, glow::BoundVertexArray &va) { va.multiDrawIndirect(mRocketCommands, NUM_ROCKET_TYPES); };
+    mQueue.push(passShadow, mQueueProgram.rocketDepth, RenderQueue::noMaterial, 0, mMeshRocket.get(), draw);
+    mQueue.push(passShadowNear, mQueueProgram.rocketDepth, RenderQueue::noMaterial, 0, mMeshRocket.get(), draw);
+    pushCulled(mQueueProgram.rocket, mQueueProgram.rocketDepth, mMaterialRocket, mCullRocket);
+  }
+
+  // mechs
+  {
+    vector<int> drawn = {player};
+    if (!fin) // fix odd bug?
+      drawn.push_back(secondPhase ? big : small);
+    for (auto m : drawn) {
+      auto drawDepth = [this, m](glow::UsedProgram &shader, glow::BoundVertexArray &va) { mechs[m].draw(shader, va, true); };
+      auto drawCulled = [this, m](glow::UsedProgram &shader, glow::BoundVertexArray &va) {
+        mechs[m].draw(shader, va, false, mCullMech[m].commands, cullVisible * sizeof(DrawElementsIndirectCommand));
+      };
+      auto va = Mech::mesh->getVA().get();
+      mQueue.push(passShadow, mQueueProgram.mechDepth, RenderQueue::noMaterial, glm::distance(mLightPos, mechs[m].drawPos), va, drawDepth);
+      mQueue.push(passShadowNear, mQueueProgram.mechDepth, RenderQueue::noMaterial, glm::distance(mLightPos, mechs[m].drawPos), va, drawDepth);
+      mQueue.push(passGBufferForward, mQueueProgram.mech, RenderQueue::noMaterial, glm::distance(camPos, mechs[m].drawPos), va, drawCulled);
+    }
+  }
+
+  // explosions, all live ones in one instanced draw, see updateExplosions
+  if (mExplosionClock - mExplosionLastBirth <= EXPLOSION_TIME) {
+    auto draw = [this](glow::UsedProgram &, glow::BoundVertexArray &va) { va.drawIndirect(mSSBOExplosionCommands, 0); };
+    for (auto pass : {passShadow, passShadowNear, passDepth})
+      mQueue.push(pass, mQueueProgram.explosionDepth, RenderQueue::noMaterial, 0, mVAExplosion.get(), draw);
+    mQueue.push(passGBuffer, mQueueProgram.explosion, RenderQueue::noMaterial, 0, mVAExplosion.get(), draw);
+  }
+
+  // neon lines, all areas in world space in the line buffer -> one item
+  {
+    // TODO rotate around center...
+    auto area = entityx::ComponentHandle<ModeArea>();
+    for (auto entity : ex.entities.entities_with_components(area))
+      if (area->mode == neon)
+        if (auto v = mLines->reserve(LineBuffer::Neon, mNeonLines.size())) {
+          auto a = *area.get();
+          for (auto const &l : mNeonLines)
+            *v++ = {a.pos + l.pos * a.radius, l.color};
+        }
+
+    if (!mLines->empty(LineBuffer::Neon)) {
+      auto draw = [this](glow::UsedProgram &, glow::BoundVertexArray &va) { mLines->draw(va, LineBuffer::Neon); };
+      mQueue.push(passGBufferForward, mQueueProgram.line, RenderQueue::noMaterial, 0, mLines->getVertexArray(), draw);
+    }
+  }
+
+  mQueue.sort();
 }
 
 
@@ -1365,18 +2026,41 @@ void Game::onGui() {
 
 // Called when window is resized
 void Game::onResize(int w, int h) {
-  // SSAA
-  w *= mSSAAFactor;
-  h *= mSSAAFactor;
-  mCurrentSSAAFactor = mSSAAFactor;
-
-  // camera viewport size is important for correct projection matrix
+  // camera viewport size is important for correct projection matrix (only the aspect, it is the same for mRenderSize)
   mCamera->setViewportSize(w, h);
+  mWindowSize = {w, h};
+
+  // SSAA, biggest possible, see updateRenderScale
+  w *= MAX_RENDER_SCALE;
+  h *= MAX_RENDER_SCALE;
 
   // resize all framebuffer textures
   for (auto const &t : mTargets)
     t->bind().resize(w, h);
   mBufferFuse->bind().resize(w, h);
+  for (auto const &t : mBufferHistory)
+    t->bind().resize(w, h);
+  mHistoryValid = false;
+
+  // hi-z, half resolution, every level exactly half of the one above
+  {
+    auto align = 1 << (HIZ_LEVELS - 1);
+    auto size = ((glm::ivec2(w, h) + 1) / 2 + align - 1) / align * align;
+    for (auto &t : mHiZ) {
+      t = glow::Texture2D::createStorageImmutable(size.x, size.y, GL_R32F, HIZ_LEVELS);
+      t->bind().setMinFilter(GL_NEAREST_MIPMAP_NEAREST);
+    }
+    mHiZValid = false;
+  }
+
+  // fuse tiles
+  mFuseTileCapacity = ((w + FUSE_TILE - 1) / FUSE_TILE) * ((h + FUSE_TILE - 1) / FUSE_TILE);
+  mSSBOFuseTiles->bind().reserve(FUSE_CLASSES * mFuseTileCapacity * sizeof(uint32_t), GL_DYNAMIC_COPY);
+
+  // light clusters
+  mClusterCapacity = ((w + CLUSTER_TILE - 1) / CLUSTER_TILE) * ((h + CLUSTER_TILE - 1) / CLUSTER_TILE) * CLUSTER_SLICES;
+  mSSBOClusters->bind().reserve(mClusterCapacity * sizeof(glm::uvec2), GL_DYNAMIC_COPY);
+  mSSBOClusterIndices->bind().reserve(mClusterCapacity * CLUSTER_AVG_LIGHTS * sizeof(uint32_t), GL_DYNAMIC_COPY);
 }
 
 bool Game::onKey(int key, int scancode, int action, int mods) {
@@ -1394,14 +2078,20 @@ bool Game::onKey(int key, int scancode, int action, int mods) {
       mFreeCamera = !mFreeCamera;
       break;
     case GLFW_KEY_A:
-      mSSAAFactor += .5;
-      if (mSSAAFactor > 2)
-        mSSAAFactor = 1;
+      // dynamic, 1, 1.5, 2
+      mSSAAFactor = mSSAAFactor == 0 ? 1 : mSSAAFactor + .5f;
+      if (mSSAAFactor > MAX_RENDER_SCALE)
+        mSSAAFactor = 0;
+      glow::log(glow::LogLevel::Info) << "SSAA: " << (mSSAAFactor == 0 ? std::string("dynamic") : to_string(mSSAAFactor));
+      break;
+    case GLFW_KEY_T:
+      mAAMode = AAMode((mAAMode + 1) % 3);
+      glow::log(glow::LogLevel::Info) << "AA: " << (mAAMode == aaFXAA ? "FXAA" : mAAMode == aaTAA ? "TAA" : "TAA + FXAA");
       break;
     case GLFW_KEY_S:
-      mShadowFactor *= 2;
-      if (mShadowFactor > 4)
-        mShadowFactor = 2; // 1 breaks my gt 1030...
+      mShadowBudgetMB *= 4; // 2048^2, 4096^2, 8192^2
+      if (mShadowBudgetMB > 384)
+        mShadowBudgetMB = 24;
       break;
     default:;
     }
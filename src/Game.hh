@@ -3,6 +3,8 @@
 #include <vector>
 
 #include <glow/fwd.hh>
+#include <glow/std140.hh>
+#include <glow/objects/UniformHandle.hh>
 
 #include <glow-extras/camera/Camera.hh>
 #include <glow-extras/glfw/GlfwApp.hh>
@@ -11,6 +13,9 @@
 
 #include <btBulletDynamicsCommon.h>
 #include "BulletDebugger.hh"
+#include "LineBuffer.hh"
+#include "Loader.hh"
+#include "load_mesh.hh"
 
 #include <soloud.h>
 #include <soloud_wav.h>
@@ -18,6 +23,9 @@
 #include <soloud_speech.h>
 
 #include "Mech.hh"
+#include "Pack.hh"
+#include "RenderQueue.hh"
+#include "ShaderVariants.hh"
 
 enum Mode {
   normal = 0,
@@ -32,9 +40,93 @@ struct ModeArea {
   float radius;
 };
 
+// uniform blocks, see data/shaders/frame.glsl
+#define MAX_MODE_AREAS 16 // same as in frame.glsl, multiple of 4
+struct FrameData {
+  glow::std140mat4 shadowViewProj;
+  glow::std140mat4 shadowViewProjNear;
+  glow::std140vec3 lightPos;
+  glow::std140float time;
+  glow::std140float skyFactor;
+  glow::std140float texShadowSize;
+  glow::std140int modeAreaCount;
+  glow::std140int lightCount;
+  glow::std140vec4 modeAreas[MAX_MODE_AREAS];          // xyz pos, w radius
+  glow::std140ivec4 modeAreaModes[MAX_MODE_AREAS / 4]; // Mode of modeAreas[i] at [i / 4][i % 4]
+  glow::std140mat4 camViewProj;                        // without TAA jitter
+  glow::std140mat4 prevCamViewProj;
+};
+
+struct ViewData {
+  glow::std140mat4 proj;
+  glow::std140mat4 view;
+  glow::std140mat4 invProj;
+  glow::std140mat4 invView;
+  glow::std140vec3 camPos;
+  glow::std140float zNear;
+  glow::std140float zFar;
+};
+
+#define MIN_RENDER_SCALE .5f
+#define MAX_RENDER_SCALE 2.f
+
+// clustered point lights, see data/shaders/lights.glsl
+#define CLUSTER_TILE 16
+#define CLUSTER_SLICES 16
+#define CLUSTER_AVG_LIGHTS 8 // size of the index list
+#define MAX_LIGHTS 1024
+struct PointLight {
+  glm::vec4 posRadius; // xyz pos, w radius
+  glm::vec4 color;     // rgb color * intensity
+};
+
+// fuse tiles, see data/shaders/fusetiles.glsl
+#define FUSE_TILE 16
+#define FUSE_CLASSES 5 // one per Mode + mixed
+#define FUSE_MIXED 4
+struct DrawArraysIndirectCommand {
+  uint32_t count;
+  uint32_t instanceCount;
+  uint32_t first;
+  uint32_t baseInstance;
+};
+
+// occlusion culling, see data/shaders/cull.csh
+#define HIZ_LEVELS 8 // same as in cull.csh
+struct DrawElementsIndirectCommand {
+  uint32_t count;
+  uint32_t instanceCount;
+  uint32_t firstIndex;
+  int32_t baseVertex;
+  uint32_t baseInstance;
+};
+enum CullList {
+  cullEarly = 0,  // visible in last frame's pyramid -> depth pre-pass
+  cullLate = 1,   // visible now but not early -> added to the depth pre-pass
+  cullVisible = 2 // visible now -> GBuffer
+};
+// instances of one mesh, culled on the GPU into one list per CullList
+// a merged mesh has one draw per range in each list, its instances are sorted by range
+struct CullGroup {
+  glow::SharedShaderStorageBuffer instances;    // aliases the instance buffer of the mesh
+  glow::SharedShaderStorageBuffer lists[3];     // aliases the instance buffers of meshes
+  glow::SharedVertexArray meshes[3];            // mesh with the instances of a list
+  glow::SharedShaderStorageBuffer earlyVisible; // flag per instance
+  glow::SharedShaderStorageBuffer commands;     // DrawElementsIndirectCommand per list and range
+  std::vector<MeshRange> ranges;
+  int stride = 1;        // vec4 per instance
+  float radius = 1;      // bounding sphere
+  bool scaleInW = false; // radius * w of the first vec4
+  int capacity = 0;
+};
+
+// explosions, GPU particles, see data/shaders/explosion.glsl
+#define MAX_EXPLOSIONS 1024 // ring buffer of emitters, same as in explosion.glsl
+#define EXPLOSION_TIME .3f
+#define EXPLOSION_CLOCK_WRAP 1024.f // seconds, see updateExplosions
 struct Explosion {
   glm::vec3 pos;
-  float time = 0;
+  float birth = -1e9f; // mExplosionClock, never alive
 };
 
 //rockettype
@@ -97,7 +189,7 @@ private:
   bool mFreeCamera = false;
   bool mCameraLocked = false;
   bool mNoAttacks = false;
-  int mShadowMapSize = 16384 / 4; // urks, high
+  int mShadowMapSize = 4096; // from mShadowBudgetMB
   glm::vec3 mLightPos = {0, 100, 0};
   float fxaaQualitySubpix = .75;
   float fxaaQualityEdgeThreshold = .166;
@@ -108,10 +200,21 @@ private:
   glm::vec3 debugAnimationTimes = {0, 0, 0};
   float debugAnimationAngle = 0;
   float drawTime = 0;
-  int mShadowFactor = 4;
-  int mCurrentShadowFactor = 4;
-  float mSSAAFactor = 1;
-  float mCurrentSSAAFactor = 1;
+  int mShadowBudgetMB = 96; // all shadow maps together, 16 bit depth
+  int mCurrentShadowBudgetMB = 0;
+  float mShadowSplit = 20; // camera distance covered by the near shadow cascade
+  // resolution scale of the window size, targets are allocated once for MAX_RENDER_SCALE
+  // and only the mRenderSize corner is rendered, output.fsh scales it to the window
+  float mSSAAFactor = 0; // fixed scale, 0 = dynamic from the GPU frame time (Alt+A)
+  enum AAMode { aaFXAA, aaTAA, aaTAAFXAA } mAAMode = aaFXAA; // Alt+T
+  float mRenderScale = 1;
+  float mTargetFrameMS = 14;      // GPU time, some headroom for 60 Hz
+  float mGpuFrameMS = 0;          // smoothed
+  glm::ivec2 mWindowSize = {1, 1};
+  glm::ivec2 mRenderSize = {1, 1};
+  glow::SharedTimerQuery mFrameTimers[4]; // results are read a few frames later, no stall
+  bool mFrameTimerStarted[4] = {};
+  int mFrameTimerIndex = 0;
 
   // gfx objects
 private:
@@ -120,72 +223,216 @@ private:
 
   // shaders
   glow::SharedProgram mShaderOutput;
-  glow::SharedProgram mShaderFuse; // was a word with C
+  glow::SharedProgram mShaderFuse[FUSE_CLASSES]; // was a word with C, one per tile class (classify.csh)
+  glow::SharedProgram mShaderClassify;
+  // geometry shaders come in variants (see ShaderVariants), *Depth is DEPTH_ONLY for shadow and depth passes
+  ShaderVariants mVariantsCube{{"../data/shaders/cube.vsh", "../data/shaders/cube.fsh"}};
+  ShaderVariants mVariantsRocket{{"../data/shaders/rocket.vsh", "../data/shaders/cube.fsh"}}; // cube.fsh with other instance data
+  ShaderVariants mVariantsMech{{"../data/shaders/mech.vsh", "../data/shaders/mech.fsh"}};
+  ShaderVariants mVariantsExplosion{{"../data/shaders/explosion.vsh", "../data/shaders/explosion.fsh"}};
   glow::SharedProgram mShaderCube;
-  glow::SharedProgram mShaderCubePrepass;
-  glow::SharedProgram mShaderMode;
+  glow::SharedProgram mShaderCubeDepth;
+  glow::SharedProgram mShaderRocket;
+  glow::SharedProgram mShaderRocketDepth;
   glow::SharedProgram mShaderUI;
   glow::SharedProgram mShaderLine;
   glow::SharedProgram mShaderExplosion;
+  glow::SharedProgram mShaderExplosionDepth;
+
+  // uniform handles, resolved once in init
+  struct {
+    glow::TextureHandle albedo, normal, material; // material: metallic, roughness
+  } mCubeUniforms, mRocketUniforms; // only mShaderCube/mShaderRocket, the depth variants have no textures
+  struct {
+    glow::TextureHandle color, normal, material, depth, skybox, brdf, paper, shadow, shadowNear, light;
+    glow::UniformHandle<int32_t> tileClass, tileCapacity;
+    glow::UniformHandle<glm::vec2> screenSize;
+  } mFuseUniforms[FUSE_CLASSES];
+  struct {
+    glow::TextureHandle depth;
+    glow::UniformHandle<int32_t> tileCapacity;
+    glow::UniformHandle<glm::vec2> screenSize;
+  } mClassifyUniforms;
+  struct {
+    glow::TextureHandle health;
+    glow::UniformHandle<int32_t> layer;
+    glow::UniformHandle<glm::mat4> model;
+  } mUIUniforms;
+  struct {
+    glow::TextureHandle color;
+    glow::UniformHandle<glm::vec2> resolution, uvScale;
+    glow::UniformHandle<float> subpix, edgeThreshold, edgeThresholdMin;
+    glow::UniformHandle<bool> fxaa;
+  } mOutputUniforms;
+
+  // render queue, filled and sorted once per frame, submitted per pass
+  enum RenderPass : uint8_t {
+    passShadowStatic = 0, // only when mStaticDirty
+    passShadow = 1,       // dynamic casters on top of the static ones
+    passShadowNear = 2,   // all casters, near cascade
+    passDepth = 3,          // culled against last frame's hi-z
+    passDepthLate = 4,      // what passDepth missed, culled against this frame's hi-z
+    passGBuffer = 5,        // depth equal, no depth write
+    passGBufferForward = 6, // depth write (mech, lines)
+  };
+  RenderQueue mQueue;
+  struct {
+    uint8_t cube, cubeDepth, rocket, rocketDepth, mech, mechDepth, line, explosion, explosionDepth;
+  } mQueueProgram;
+  uint16_t mMaterialCube = RenderQueue::noMaterial;
+  uint16_t mMaterialRocket;
+
+  // uniform blocks shared by all shaders
+  glow::SharedUniformBuffer mUBFrame;
+  glow::SharedUniformBuffer mUBView; // refilled per view (shadow, camera)
 
   // meshes
   glow::SharedVertexArray mMeshQuad;
-  glow::SharedVertexArray mMeshCube;
-  glow::SharedVertexArray mMeshSphere;
-  glow::SharedVertexArray mMeshRocket[NUM_ROCKET_TYPES];
-  glow::SharedVertexArray mVALine;
+  glow::SharedVertexArray mMeshCube;       // static cubes
+  glow::SharedVertexArray mMeshCubeMoving; // same mesh, other instances
+  glow::SharedVertexArray mMeshRocket;      // all types, instances sorted by type
+  MeshRange mRocketRanges[NUM_ROCKET_TYPES]; // of the types in mMeshRocket
+  glow::SharedShaderStorageBuffer mRocketCommands; // one DrawElementsIndirectCommand per type, not culled (shadows)
   glow::SharedVertexArray mVAExplosion;
 
   // mech
   glow::SharedProgram mShaderMech;
+  glow::SharedProgram mShaderMechDepth;
+  struct {
+    glow::UniformHandle<bool> blink;
+    glow::UniformHandle<glm::mat4> model;
+    glow::UniformHandle<glm::mat4> bones;
+    glow::UniformHandle<glm::mat4> prevModel, prevBones;
+    glow::TextureHandle albedo, normal, material;
+  } mMechUniforms, mMechDepthUniforms; // the depth variant only has model and bones
   Mech mechs[3];
 
   // textures
   glow::SharedTexture2D mTexCubeAlbedo;
   glow::SharedTexture2D mTexCubeNormal;
-  glow::SharedTexture2D mTexCubeMetallic;
-  glow::SharedTexture2D mTexCubeRoughness;
+  glow::SharedTexture2D mTexCubeMaterial; // metallic, roughness
   glow::SharedTexture2D mTexDefNormal;
   glow::SharedTexture2D mTexDefMaterial;
-  glow::SharedTextureCubeMap mSkybox;
-  glow::SharedTexture mHealthBar[MAX_HEALTH + 1];
-  glow::SharedTexture2D mTexRocketAlbedo[NUM_ROCKET_TYPES];
-  glow::SharedTexture2D mTexRocketNormal[NUM_ROCKET_TYPES];
-  glow::SharedTexture2D mTexRocketMetallic[NUM_ROCKET_TYPES];
-  glow::SharedTexture2D mTexRocketRoughness[NUM_ROCKET_TYPES];
+  glow::SharedTextureCubeMap mSkybox; // GGX prefiltered, see tools/cook.cc
+  glow::SharedTexture2D mTexBRDF;      // split sum lookup, computed once by brdf.csh
+  glow::SharedTexture2DArray mHealthBar;        // layer = health
+  glow::SharedTexture2DArray mTexRocketAlbedo;   // layer = rtype
+  glow::SharedTexture2DArray mTexRocketNormal;
+  glow::SharedTexture2DArray mTexRocketMaterial;
   glow::SharedTexture2D mTexPaper;
 
   // Shadow
   int mMaxShadowSize = 0;
   glow::SharedTextureRectangle mBufferShadow;
   glow::SharedFramebuffer mFramebufferShadow;
+  glow::SharedTextureRectangle mBufferShadowStatic; // floor and pillars, copied into mBufferShadow each frame
+  glow::SharedFramebuffer mFramebufferShadowStatic;
+  glow::SharedTextureRectangle mBufferShadowNear; // fitted to the camera, everything each frame
+  glow::SharedFramebuffer mFramebufferShadowNear;
+  glm::mat4 mShadowProjStatic;                    // mBufferShadowStatic was drawn with this
+  void resizeShadows();
 
   // depth pre-pass
   glow::SharedTextureRectangle mGBufferDepth;
   glow::SharedFramebuffer mFramebufferDepth;
 
-  // Mode
-  glow::SharedTextureRectangle mBufferMode;
-  glow::SharedFramebuffer mFramebufferMode;
-
   // opaque
   glow::SharedTextureRectangle mGBufferAlbedo;
   glow::SharedTextureRectangle mGBufferMaterial;
   glow::SharedTextureRectangle mGBufferNormal;
+  glow::SharedTextureRectangle mGBufferVelocity; // for TAA
   glow::SharedFramebuffer mFramebufferGBuffer;
 
   // light
-  glow::SharedTextureRectangle mBufferLight;
+  glow::SharedTextureRectangle mBufferLight; // point lights, diffuse irradiance
   glow::SharedFramebuffer mFramebufferLight;
+  glow::SharedProgram mShaderCluster; // compute, builds the light list per cluster
+  glow::SharedProgram mShaderLight;
+  glow::SharedShaderStorageBuffer mSSBOLights;
+  glow::SharedShaderStorageBuffer mSSBOClusters;
+  glow::SharedShaderStorageBuffer mSSBOClusterIndices;
+  glow::SharedShaderStorageBuffer mSSBOClusterCounter;
+  glm::ivec3 mClusterCount = {1, 1, CLUSTER_SLICES}; // of mRenderSize
+  int mClusterCapacity = 1;                          // clusters of the full targets
+  int mLightCount = 0;
+  struct {
+    glow::UniformHandle<glm::ivec3> clusterCount;
+    glow::UniformHandle<int32_t> indexCapacity;
+    glow::UniformHandle<glm::vec2> screenSize;
+  } mClusterUniforms;
+  struct {
+    glow::UniformHandle<glm::ivec3> clusterCount;
+    glow::TextureHandle normal, depth;
+  } mLightUniforms;
 
   //fusing
   glow::SharedTexture2D mBufferFuse;
   glow::SharedFramebuffer mFramebufferFuse;
+  glow::SharedShaderStorageBuffer mSSBOFuseTiles;    // FUSE_CLASSES lists of tiles
+  glow::SharedShaderStorageBuffer mSSBOFuseCommands; // one indirect draw per class
+  int mFuseTileCapacity = 1; // tiles of the full targets
+
+  // temporal AA, resolves into one history while reading the other
+  glow::SharedProgram mShaderTAA;
+  glow::SharedTexture2D mBufferHistory[2];
+  glow::SharedFramebuffer mFramebufferHistory[2];
+  int mHistoryIndex = 0;           // written this frame
+  bool mHistoryValid = false;
+  glm::ivec2 mHistorySize = {1, 1}; // mRenderSize of the last frame
+  glm::mat4 mPrevCamViewProj;
+  int mJitterIndex = 0;
+  struct {
+    glow::TextureHandle color, history, velocity, depth;
+    glow::UniformHandle<glm::vec2> historyUVScale;
+    glow::UniformHandle<float> historyWeight;
+    glow::UniformHandle<glm::ivec2> renderSize;
+  } mTAAUniforms;
+
+  // occlusion culling against a hierarchical z pyramid of the depth pre-pass
+  glow::SharedProgram mShaderHiZ;            // compute, one level per dispatch
+  glow::SharedProgram mShaderCull;           // compute, one instance per invocation
+  glow::SharedTexture2D mHiZ[2];             // this and last frame
+  glm::ivec2 mHiZSize[2] = {{1, 1}, {1, 1}}; // mRenderSize they were built from
+  int mHiZIndex = 0;                         // built this frame
+  bool mHiZValid = false;                    // last frame's
+  CullGroup mCullCube, mCullCubeMoving, mCullRocket, mCullMech[3];
+  struct {
+    glow::TextureHandle depth;
+    glow::UniformHandle<int32_t> level;
+    glow::UniformHandle<glm::ivec2> srcSize;
+  } mHiZUniforms;
+  struct {
+    glow::TextureHandle hiz;
+    glow::UniformHandle<glm::ivec2> hizScreenSize;
+    glow::UniformHandle<bool> hizValid, late, scaleInW;
+    glow::UniformHandle<int32_t> count, stride, draws;
+    glow::UniformHandle<float> radius;
+  } mCullUniforms;
+  // ranges: the draws of a merged mesh, empty for one draw of the whole mesh
+  CullGroup createCullGroup(glow::SharedVertexArray const &mesh, std::string const &instanceAttribute, float radius, bool scaleInW,
+                            std::vector<MeshRange> ranges = {});
+  void buildHiZ();
+  void cull(CullGroup &g, std::vector<int> const &counts, bool late); // instances per range
 
   std::vector<glow::SharedTextureRectangle> mTargets;
 
-  std::list<Explosion> explosions;
-
+  // explosions: emitters are added to a ring, explosion.csh lists the live ones once per frame
+  // -> one indirect instanced draw per pass, no matter how many
+  glow::SharedProgram mShaderExplosionSim;
+  glow::SharedShaderStorageBuffer mSSBOExplosions;        // the ring
+  glow::SharedShaderStorageBuffer mSSBOExplosionVertices; // sphere triangles, see explosion.vsh
+  glow::SharedShaderStorageBuffer mSSBOExplosionCommands; // one DrawArraysIndirectCommand
+  glow::UniformHandle<float> mExplosionSimClock;
+  Explosion mExplosions[MAX_EXPLOSIONS]; // copy of the ring, for the lights
+  int mExplosionHead = 0;                // next slot
+  int mExplosionNew = 0;                 // added since the last upload
+  float mExplosionClock = 0;
+  float mExplosionLastBirth = -1e9f;
+  void addExplosion(glm::vec3 pos);
+
+  // Assets
+private:
+  std::unique_ptr<Pack> mPack; // before the sounds, the music streams straight from it
 
   // Sound
 private:
@@ -229,22 +476,32 @@ private:
 
 
   // main
+  std::unique_ptr<LineBuffer> mLines;             // debug and neon lines, written every frame
+  std::vector<LineBuffer::Vertex> mNeonLines;      // unit sphere, placed into each neon area
   std::unique_ptr<BulletDebugger> bulletDebugger; // draws lines for debugging
   std::unique_ptr<btDefaultCollisionConfiguration> collisionConfiguration;
   std::unique_ptr<btCollisionDispatcher> dispatcher;
   std::unique_ptr<btBroadphaseInterface> overlappingPairCache;
   std::unique_ptr<btSequentialImpulseConstraintSolver> solver;
   std::unique_ptr<btDiscreteDynamicsWorld> dynamicsWorld;
+  enum { loadFirstFrame = 0, loadPhase2 = 1 }; // stages of mLoader
+  std::unique_ptr<Loader> mLoader;             // after everything its jobs write to, see init
 
 
 
   //draw
 private:
-  void drawMech(glow::UsedProgram shader, glm::mat4 proj, glm::mat4 view);
-  void drawCubes(glow::UsedProgram shader, glm::mat4 proj, glm::mat4 view);
-  void drawRockets(glow::UsedProgram shader, glm::mat4 proj, glm::mat4 view);
-  void drawLines(glow::UsedProgram shader, glm::mat4 proj, glm::mat4 view);
-  void drawExplosion(glow::UsedProgram shader, glm::mat4 proj, glm::mat4 view, float dT = 0);
+  void setView(glm::mat4 proj, glm::mat4 view); // fills mUBView
+  void updateExplosions(float dT);
+  void uploadCubes(); // instance buffers, once per frame for all passes
+  void uploadRockets();
+  void fillQueue(glm::vec3 camPos);
+  void uploadLights(); // one per rocket and explosion
+  void updateRenderScale();
+  int mCubeCount = 0;       // static
+  int mCubeMovingCount = 0;
+  bool mStaticDirty = true; // static cubes changed -> reupload, redraw static shadow
+  int mRocketCount[NUM_ROCKET_TYPES] = {};
 
   // ctor
 public:
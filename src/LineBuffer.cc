@@ -0,0 +1,83 @@
+#include "LineBuffer.hh"
+
+#include <glow/common/log.hh>
+#include <glow/objects/ArrayBuffer.hh>
+#include <glow/objects/VertexArray.hh>
+
+using namespace glow;
+
+LineBuffer::LineBuffer(size_t verticesPerFrame) : mCapacity(verticesPerFrame) {
+  mBuffer = ArrayBuffer::create();
+  mBuffer->setObjectLabel("Lines");
+  mBuffer->defineAttributes({{&Vertex::pos, "position"}, //
+                             {&Vertex::color, "color"}});
+  {
+    // coherent: writes are visible to the next draw without flushing
+    auto flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    auto size = sizeof(Vertex) * mCapacity * REGIONS;
+    auto ab = mBuffer->bind();
+    ab.setStorage(size, flags);
+    mMapped = (Vertex *)ab.mapRange(0, size, flags);
+  }
+  mVA = VertexArray::create(mBuffer, GL_LINES);
+  mVA->setObjectLabel("Lines");
+}
+
+LineBuffer::~LineBuffer() {
+  for (auto f : mFences)
+    if (f)
+      glDeleteSync(f);
+  if (mMapped)
+    mBuffer->bind().unmap();
+}
+
+LineBuffer::Vertex *LineBuffer::reserve(uint32_t category, size_t count) {
+  if (!isEnabled(category) || !mMapped)
+    return nullptr;
+  if (mSize + count > mCapacity) {
+    static bool warned = false;
+    if (!warned)
+      glow::warning() << "LineBuffer full, dropping lines";
+    warned = true;
+    return nullptr;
+  }
+
+  // consecutive lines of one category are one draw
+  if (!mBatches.empty() && mBatches.back().category == category)
+    mBatches.back().count += count;
+  else
+    mBatches.push_back({category, mSize, count});
+
+  auto v = mMapped + mRegion * mCapacity + mSize;
+  mSize += count;
+  return v;
+}
+
+void LineBuffer::draw(BoundVertexArray &va, uint32_t categories) const {
+  auto base = mRegion * mCapacity;
+  for (auto const &b : mBatches)
+    if (b.category & categories)
+      va.drawRange(base + b.first, base + b.first + b.count);
+}
+
+bool LineBuffer::empty(uint32_t categories) const {
+  for (auto const &b : mBatches)
+    if (b.category & categories)
+      return false;
+  return true;
+}
+
+void LineBuffer::nextFrame() {
+  mFences[mRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  mRegion = (mRegion + 1) % REGIONS;
+
+  // usually long done, the region was last drawn 2 frames ago
+  if (auto &f = mFences[mRegion]) {
+    glClientWaitSync(f, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    glDeleteSync(f);
+    f = nullptr;
+  }
+
+  mSize = 0;
+  mBatches.clear();
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glow/fwd.hh>
+#include <glow/gl.hh>
+
+#include <glm/glm.hpp>
+
+// immediate mode lines, written straight into a persistently mapped buffer
+// the buffer has 3 regions (one per frame in flight), a fence guards each one
+// lines of disabled categories are dropped right away -> emitting them is close to free
+class LineBuffer {
+public:
+  enum Category : uint32_t {
+    Physics = 1 << 0, // bullet debug drawer
+    Probes = 1 << 1,  // ground and explosion rays
+    Neon = 1 << 2,    // neon mode areas
+  };
+
+  struct Vertex {
+    glm::vec3 pos;
+    glm::vec3 color;
+  };
+
+  LineBuffer(size_t verticesPerFrame = 1 << 17);
+  ~LineBuffer();
+
+  uint32_t mask = Neon; // enabled categories
+  bool isEnabled(uint32_t category) const { return mask & category; }
+
+  void line(uint32_t category, glm::vec3 from, glm::vec3 to, glm::vec3 color) {
+    if (!isEnabled(category))
+      return;
+    if (auto v = reserve(category, 2)) {
+      v[0] = {from, color};
+      v[1] = {to, color};
+    }
+  }
+  // space for count vertices (count / 2 lines) to write to, nullptr if disabled or full
+  Vertex *reserve(uint32_t category, size_t count);
+
+  // GL_LINES, attributes "position" and "color"
+  glow::VertexArray *getVertexArray() const { return mVA.get(); }
+  // draws the lines of this frame in the categories, with getVertexArray() bound
+  void draw(glow::BoundVertexArray &va, uint32_t categories) const;
+  bool empty(uint32_t categories) const;
+
+  // after the last draw of the frame, starts writing to the next region
+  void nextFrame();
+
+private:
+  static const int REGIONS = 3;
+
+  struct Batch {
+    uint32_t category;
+    size_t first; // in the region
+    size_t count;
+  };
+
+  size_t mCapacity; // vertices per region
+  glow::SharedArrayBuffer mBuffer;
+  glow::SharedVertexArray mVA;
+  Vertex *mMapped = nullptr; // whole buffer
+  GLsync mFences[REGIONS] = {};
+  int mRegion = 0;
+  size_t mSize = 0; // vertices in the current region
+  std::vector<Batch> mBatches;
+};
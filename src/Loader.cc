@@ -0,0 +1,324 @@
+#include "Loader.hh"
+#include "Pack.hh"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+#include <glow/common/log.hh>
+#include <glow/data/SurfaceData.hh>
+#include <glow/data/TextureData.hh>
+#include <glow/objects/ArrayBuffer.hh>
+#include <glow/objects/Texture2D.hh>
+#include <glow/objects/Texture2DArray.hh>
+#include <glow/objects/TextureCubeMap.hh>
+
+using namespace std;
+
+Loader::Loader(Pack const &pack, int threads, size_t stagingSize) : mPack(pack), mStagingSize(stagingSize) {
+  mBegin = Clock::now();
+
+  if (threads <= 0)
+    threads = max(1, (int)thread::hardware_concurrency() - 1);
+  for (int i = 0; i < threads; i++)
+    mThreads.emplace_back(&Loader::worker, this, i);
+
+  if (mStagingSize > 0) {
+    // written by the workers, read by texture uploads, never by the cpu again
+    auto flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    mStaging = glow::ArrayBuffer::create();
+    mStaging->setObjectLabel("Loader staging");
+    auto ab = mStaging->bind();
+    ab.setStorage(mStagingSize, flags);
+    mStagingPtr = (char *)ab.mapRange(0, mStagingSize, flags);
+  }
+}
+
+Loader::~Loader() {
+  {
+    lock_guard<mutex> lock(mMutex);
+    mStop = true;
+  }
+  mWorkReady.notify_all();
+  for (auto &t : mThreads)
+    t.join();
+  if (mStagingPtr)
+    mStaging->bind().unmap();
+}
+
+void Loader::setStage(int stage) {
+  lock_guard<mutex> lock(mMutex);
+  mStage = stage;
+}
+
+Loader::Job Loader::work(string name, function<void()> fn, vector<Job> deps) {
+  return add(move(name), move(fn), false, move(deps));
+}
+
+Loader::Job Loader::main(string name, function<void()> fn, vector<Job> deps) {
+  return add(move(name), move(fn), true, move(deps));
+}
+
+Loader::Stage &Loader::getStage(int stage) {
+  assert(stage >= 0);
+  if ((int)mStages.size() <= stage)
+    mStages.resize(stage + 1);
+  return mStages[stage];
+}
+
+Loader::Job Loader::add(string name, function<void()> fn, bool onMain, vector<Job> deps) {
+  lock_guard<mutex> lock(mMutex);
+  Job job = mNodes.size();
+  mNodes.push_back({move(name), move(fn), onMain, mStage, move(deps)});
+  getStage(mStage).jobs++;
+  auto &node = mNodes.back();
+  for (auto d : node.deps) {
+    assert(d < job && "dependencies have to be added first");
+    if (!mNodes[d].done) {
+      mNodes[d].dependents.push_back(job);
+      node.waiting++;
+    }
+  }
+  if (node.waiting == 0)
+    ready(job);
+  return job;
+}
+
+void Loader::ready(Job job) {
+  auto &stage = mStages[mNodes[job].stage];
+  if (mNodes[job].onMain) {
+    stage.main.push_back(job);
+    mMainReady.notify_one();
+  } else {
+    stage.work.push_back(job);
+    mWorkReady.notify_one();
+  }
+}
+
+void Loader::complete(Job job) {
+  auto &node = mNodes[job];
+  node.done = true;
+  mDone++;
+  mStages[node.stage].done++;
+  for (auto d : node.dependents)
+    if (--mNodes[d].waiting == 0)
+      ready(d);
+  mMainReady.notify_one(); // wait() waits for the last one
+}
+
+void Loader::run(Job job, int thread, unique_lock<mutex> &lock) {
+  auto &node = mNodes[job];
+  node.thread = thread;
+  node.start = Clock::now();
+  lock.unlock();
+  try {
+    node.fn();
+  } catch (exception const &e) {
+    glow::error() << "loading " << node.name << " failed: " << e.what();
+  }
+  lock.lock();
+  node.end = Clock::now();
+  complete(job);
+}
+
+bool Loader::pop(bool onMain, int maxStage, Job &job) {
+  for (int s = 0; s < (int)mStages.size() && s <= maxStage; s++) {
+    auto &queue = onMain ? mStages[s].main : mStages[s].work;
+    if (!queue.empty()) {
+      job = queue.front();
+      queue.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Loader::stageDone(int stage) const {
+  for (int s = 0; s < (int)mStages.size() && s <= stage; s++)
+    if (mStages[s].done < mStages[s].jobs)
+      return false;
+  return true;
+}
+
+void Loader::worker(int thread) {
+  unique_lock<mutex> lock(mMutex);
+  while (true) {
+    Job job;
+    while (!mStop && !pop(false, mStages.size(), job))
+      mWorkReady.wait(lock);
+    if (mStop)
+      return;
+    run(job, thread, lock);
+  }
+}
+
+void Loader::wait(int stage) {
+  unique_lock<mutex> lock(mMutex);
+  auto &s = getStage(stage);
+  s.waitCalled = min(s.waitCalled, Clock::now());
+  while (!stageDone(stage)) {
+    Job job;
+    if (pop(true, stage, job))
+      run(job, -1, lock);
+    else
+      mMainReady.wait(lock);
+  }
+  afterMain();
+}
+
+void Loader::poll(Clock::duration budget) {
+  unique_lock<mutex> lock(mMutex);
+  auto until = Clock::now() + budget;
+  Job job;
+  while (pop(true, mStages.size(), job)) {
+    run(job, -1, lock);
+    if (Clock::now() >= until)
+      break;
+  }
+  afterMain();
+}
+
+bool Loader::isDone(int stage) {
+  lock_guard<mutex> lock(mMutex);
+  return stageDone(stage);
+}
+
+void Loader::afterMain() {
+  for (int s = 0; s < (int)mStages.size(); s++)
+    if (!mStages[s].reported && mStages[s].done == mStages[s].jobs) {
+      mStages[s].reported = true;
+      report(s);
+    }
+
+  // the uploads are queued, GL keeps the buffer alive until they are done
+  if (mDone == mNodes.size() && mStagingPtr) {
+    mStaging->bind().unmap();
+    mStagingPtr = nullptr;
+    mStaging = nullptr;
+  }
+}
+
+void Loader::report(int stage) const {
+  if (mStages[stage].jobs == 0)
+    return;
+  auto ms = [&](Clock::time_point t) { return chrono::duration<double, milli>(t - mBegin).count(); };
+  auto line = [](char const *fmt, double a, double b = 0) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), fmt, a, b);
+    return string(buf);
+  };
+
+  double work = 0;
+  Job last = mNodes.size();
+  for (Job j = 0; j < mNodes.size(); j++)
+    if (mNodes[j].stage == stage) {
+      work += ms(mNodes[j].end) - ms(mNodes[j].start);
+      if (last == mNodes.size() || mNodes[j].end > mNodes[last].end)
+        last = j;
+    }
+  glow::info() << "loading stage " << stage << ": " << mStages[stage].jobs << " jobs on " << mThreads.size() << " workers + main, "
+               << line("done after %.1f ms, %.1f ms of work", ms(mNodes[last].end), work);
+
+  // back from the job that finished last, always through the dependency that finished last
+  vector<Job> path = {last};
+  while (!mNodes[path.back()].deps.empty()) {
+    auto const &deps = mNodes[path.back()].deps;
+    path.push_back(*max_element(deps.begin(), deps.end(), [&](Job a, Job b) { return mNodes[a].end < mNodes[b].end; }));
+  }
+  reverse(path.begin(), path.end());
+
+  glow::info() << "critical path:";
+  auto prevEnd = mBegin;
+  for (auto j : path) {
+    auto const &node = mNodes[j];
+    // time between being ready and running: no free worker, or main was busy elsewhere
+    auto queued = ms(node.start) - ms(prevEnd);
+    auto waitCalled = mStages[node.stage].waitCalled;
+    string why;
+    if (node.onMain && queued > 1 && waitCalled == Clock::time_point::max())
+      why = ", streamed by poll()";
+    else if (node.onMain && queued > 1 && prevEnd < waitCalled)
+      why = ", main thread was busy before wait()";
+    glow::info() << line("  %7.1f ..%7.1f ms  ", ms(node.start), ms(node.end)) << (node.onMain ? "main " : "work ") << node.name
+                 << (queued > 1 ? line("  (queued %.1f ms", queued) + why + ")" : "");
+    prevEnd = node.end;
+  }
+}
+
+bool Loader::copyToStaging(glow::TextureData &data) {
+  auto const &surfaces = data.getSurfaces();
+  if (surfaces.empty() || !surfaces[0]->isCompressed())
+    return false; // uncompressed data is converted by the driver anyway
+
+  auto align = [](size_t s) { return (s + 15) & ~size_t(15); };
+  size_t size = 0;
+  for (auto const &s : surfaces)
+    size += align(s->getDataSize());
+
+  size_t offset;
+  {
+    lock_guard<mutex> lock(mMutex);
+    if (!mStagingPtr || mStagingUsed + size > mStagingSize)
+      return false;
+    offset = mStagingUsed;
+    mStagingUsed += size;
+  }
+
+  // the pointers become offsets into the buffer, only valid while it is bound as GL_PIXEL_UNPACK_BUFFER
+  for (auto const &s : surfaces) {
+    auto n = s->getDataSize();
+    memcpy(mStagingPtr + offset, s->getDataPtr(), n);
+    s->setExternalData(nullptr, reinterpret_cast<char const *>(offset), n);
+    offset += align(n);
+  }
+  return true;
+}
+
+template <class Tex>
+Loader::Job Loader::loadTexture(shared_ptr<Tex> &target, string const &path, glow::ColorSpace colorSpace) {
+  struct State {
+    glow::SharedTextureData data;
+    bool staged = false;
+  };
+  auto state = make_shared<State>();
+
+  auto decode = work(path, [=] {
+    auto blob = mPack.get(path);
+    if (!blob)
+      return;
+    if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".dds") == 0)
+      state->data = glow::TextureData::createFromRawDDS(blob.data, blob.size, blob.owner, colorSpace);
+    else
+      state->data = glow::TextureData::createFromRawPng((unsigned char const *)blob.data, blob.size, colorSpace);
+    if (state->data)
+      state->staged = copyToStaging(*state->data);
+  });
+  return main("upload " + path, [=, &target] {
+    if (!state->data)
+      return; // already reported by the decode
+    if (state->staged)
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mStaging->getObjectName());
+    if (target)
+      target->bind().setData(state->data->getPreferredInternalFormat(), state->data);
+    else
+      target = Tex::createFromData(state->data);
+    if (state->staged)
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    target->setObjectLabel(path);
+    state->data = nullptr;
+  }, {decode});
+}
+
+Loader::Job Loader::texture(glow::SharedTexture2D &target, string const &path, glow::ColorSpace colorSpace) {
+  return loadTexture(target, path, colorSpace);
+}
+
+Loader::Job Loader::texture(glow::SharedTextureCubeMap &target, string const &path, glow::ColorSpace colorSpace) {
+  return loadTexture(target, path, colorSpace);
+}
+
+Loader::Job Loader::texture(glow::SharedTexture2DArray &target, string const &path, glow::ColorSpace colorSpace) {
+  return loadTexture(target, path, colorSpace);
+}
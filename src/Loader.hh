@@ -0,0 +1,108 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glow/fwd.hh>
+#include <glow/data/ColorSpace.hh>
+
+class Pack;
+
+// asset loading as a job graph on a fixed pool of worker threads
+// work jobs run on the workers, main jobs (GL) on the main thread in wait() and poll()
+// a job starts as soon as all of its dependencies are done, so uploads happen in the order decodes finish
+// compressed texture data is copied into a persistently mapped pixel unpack buffer by the workers,
+// the upload on the main thread then is just a transfer from that buffer
+// jobs belong to stages: lower stages go first, wait(stage) blocks for one, later ones can stream in with poll()
+// files are read through the pack, paths are relative to data/
+class Loader {
+public:
+  using Job = size_t;
+  using Clock = std::chrono::steady_clock;
+
+  // threads = 0: one less than the hardware threads (the main thread uploads), at least one
+  Loader(Pack const &pack, int threads = 0, size_t stagingSize = 64 << 20);
+  ~Loader();
+
+  // jobs added from now on belong to the stage
+  void setStage(int stage);
+
+  Job work(std::string name, std::function<void()> fn, std::vector<Job> deps = {});
+  Job main(std::string name, std::function<void()> fn, std::vector<Job> deps = {});
+
+  // decode on a worker, upload on the main thread
+  // a null target is set by the upload, an existing one keeps its object (e.g. already used in a material)
+  // .dds (surfaces point into the pack until staged) or .png
+  Job texture(glow::SharedTexture2D &target, std::string const &path, glow::ColorSpace colorSpace);
+  Job texture(glow::SharedTextureCubeMap &target, std::string const &path, glow::ColorSpace colorSpace);
+  Job texture(glow::SharedTexture2DArray &target, std::string const &path, glow::ColorSpace colorSpace); // .dds with layers
+
+  // runs main jobs until the stage and all before it are done
+  // every finished stage logs its timings and critical path
+  void wait(int stage);
+  // runs ready main jobs for about the budget (at least one, if there is one), once per frame
+  void poll(Clock::duration budget);
+  bool isDone(int stage);
+
+private:
+  struct Node {
+    std::string name;
+    std::function<void()> fn;
+    bool onMain;
+    int stage;
+    std::vector<Job> deps;
+    std::vector<Job> dependents;
+    int waiting = 0; // unfinished deps
+    bool done = false;
+    Clock::time_point start, end;
+    int thread = -1; // -1: main
+  };
+  struct Stage {
+    std::deque<Job> work, main; // ready jobs
+    size_t jobs = 0, done = 0;
+    bool reported = false;
+    Clock::time_point waitCalled = Clock::time_point::max();
+  };
+
+  // all with mMutex held
+  Job add(std::string name, std::function<void()> fn, bool onMain, std::vector<Job> deps);
+  Stage &getStage(int stage);
+  void ready(Job job);
+  void complete(Job job);
+  void run(Job job, int thread, std::unique_lock<std::mutex> &lock);
+  bool pop(bool onMain, int maxStage, Job &job);
+  bool stageDone(int stage) const;
+  void afterMain(); // reports finished stages, releases the staging buffer once all is done
+  void report(int stage) const;
+
+  void worker(int thread);
+
+  // copies the surfaces into the staging buffer, true if they now point to offsets in it
+  bool copyToStaging(glow::TextureData &data);
+  template <class Tex>
+  Job loadTexture(std::shared_ptr<Tex> &target, std::string const &path, glow::ColorSpace colorSpace);
+
+  Pack const &mPack;
+  std::vector<std::thread> mThreads;
+  std::mutex mMutex;
+  std::condition_variable mWorkReady;
+  std::condition_variable mMainReady; // also signaled when any job completes
+  std::deque<Node> mNodes;            // stable references
+  std::vector<Stage> mStages;
+  int mStage = 0; // of new jobs
+  size_t mDone = 0;
+  bool mStop = false;
+  Clock::time_point mBegin;
+
+  glow::SharedArrayBuffer mStaging;
+  char *mStagingPtr = nullptr;
+  size_t mStagingSize;
+  size_t mStagingUsed = 0; // with mMutex held
+};
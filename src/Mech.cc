@@ -115,29 +115,56 @@ glm::mat4 Mech::getModelMatrix() {
   return model;
 }
 
-void Mech::draw(glow::UsedProgram &shader) {
-  shader.setUniform("uBlink", (blink < 1 && fmod(blink, .2) > .1));
-  shader.setUniform("uModel", getModelMatrix());
-  shader.setTexture("uTexAlbedo", texAlbedo);
-  shader.setTexture("uTexNormal", texNormal);
-  shader.setTexture("uTexMaterial", texMaterial);
+void Mech::draw(glow::UsedProgram &shader, glow::BoundVertexArray &va, bool depthOnly, glow::SharedBuffer const &commands, size_t offset) {
+  auto g = Game::instance;
+  auto &u = depthOnly ? g->mMechDepthUniforms : g->mMechUniforms;
+  lastModel = getModelMatrix();
+  shader.setUniform(u.model, lastModel);
+  if (!depthOnly) {
+    shader.setUniform(u.blink, (blink < 1 && fmod(blink, .2) > .1));
+    shader.setTexture(u.albedo, texAlbedo);
+    shader.setTexture(u.normal, texNormal);
+    shader.setTexture(u.material, texMaterial);
+  }
 
 
   //mesh->draw(shader, animationsTime[0], loops[animations[0]], names[animations[0]]);
-  auto g = Game::instance;
   if (!g->DebugingAnimations)
     bones = mesh->getMechBones(names[animations[0]], names[animations[1]], names[animationTop], animationAlpha, animationsTime[0], animationsTime[1], animationTimeTop, getAngleView());
   else
     bones = mesh->getMechBones(names[(animation)g->debugAnimations[0]], names[(animation)g->debugAnimations[1]], names[(animation)g->debugAnimations[2]], //
                                g->debugAnimationAlpha, g->debugAnimationTimes[0], g->debugAnimationTimes[1], g->debugAnimationTimes[2], g->debugAnimationAngle);
 
-  shader.setUniform("uBones[0]", MAX_BONES, bones.data()); // really, uBones[0] instead of uBones...
+  shader.setUniform(u.bones, MAX_BONES, bones.data());
+  if (prevBones.size() != bones.size()) { // first frame
+    prevBones = bones;
+    prevModel = lastModel;
+  }
+  if (!depthOnly) {
+    shader.setUniform(u.prevModel, prevModel);
+    shader.setUniform(u.prevBones, MAX_BONES, prevBones.data());
+  }
 
-  mesh->getVA()->bind().draw();
+  if (commands)
+    va.drawIndirect(commands, offset);
+  else
+    va.draw();
 
   //mechModel->draw(shader, debugTime, true, "Hit"); //"WalkInPlace");
   // skeleton
-  // mechModel->debugRenderer.render(proj * view * glm::scale(glm::vec3(0.01)));
+  // mechModel->debugRenderer->render(proj * view * glm::scale(glm::vec3(0.01)));
+}
+
+void Mech::newFrame() {
+  prevBones = bones;
+  prevModel = lastModel;
+}
+
+glm::vec4 Mech::getBoundingSphere() {
+  // bind pose bounds, limbs move a bit outside
+  auto center = glm::vec3(getModelMatrix() * glm::vec4((mesh->aabbMin + mesh->aabbMax) / 2.f, 1));
+  auto radius = glm::length(mesh->aabbMax - mesh->aabbMin) / 2.f * (float)scale * 1.25f;
+  return glm::vec4(center, radius);
 }
 
 glm::vec3 Mech::getPos() {
@@ -319,7 +346,7 @@ void Mech::controlPlayer(int) {
         if (from.y() <= 0.05 && from.y() > -0.01)                                                                                  //stuck slighlty in ground...
           from.setY(0.1);
         auto to = from - btVector3(0, closeToGroundBorder, 0);
-        g->dynamicsWorld->getDebugDrawer()->drawLine(from, to, btVector4(1, 0, 0, 1));
+        g->mLines->line(LineBuffer::Probes, glcast(from), glcast(to), {1, 0, 0});
         auto closest = btCollisionWorld::ClosestRayResultCallback(from, to);
         g->dynamicsWorld->rayTest(from, to, closest);
         if (closest.hasHit())
@@ -831,7 +858,7 @@ void Mech::dieSmall(int t) {
   //explode
   auto pos = glm::vec3(m.getModelMatrix() * (m.bones[mesh->getMechBoneID("Body")] * glm::vec4(0, 0, 0, 1.))) - m.meshOffset;
   auto p = pos + (glm::vec3(2, 4, 2) * g->spherePoints[rand() % 400]);
-  g->explosions.push_back({p, 0});
+  g->addExplosion(p);
   if (t % 10 == 0)
     g->soloud->play3d(g->sfxExpl1, p.x, p.y, p.z, 0, 0, 0, .5);
 
@@ -69,6 +69,10 @@ struct Mech : SM {
   double floatOffset; // from bottom
   double scale = 1;
   std::vector<glm::mat4> bones;
+  // pose of the last frame, for the velocity buffer
+  std::vector<glm::mat4> prevBones;
+  glm::mat4 lastModel, prevModel;
+  void newFrame();
   bool didStep = false; // make sound if it makes sense
 
   // Small
@@ -103,7 +107,10 @@ struct Mech : SM {
   //void updateLogic();
   void updateTime(double delta);
   void updateLook();
-  void draw(glow::UsedProgram &shader);
+  // va is mesh->getVA(), depthOnly: shadows and depth (mShaderMechDepth), only the skinned positions
+  // with commands only if the indirect command says so (occlusion culling)
+  void draw(glow::UsedProgram &shader, glow::BoundVertexArray &va, bool depthOnly, glow::SharedBuffer const &commands = nullptr, size_t offset = 0);
+  glm::vec4 getBoundingSphere(); // xyz center, w radius, with some room for the animations
   glm::vec3 getPos();
   void setPosition(glm::vec3);
   float getAngleMove();
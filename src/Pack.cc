@@ -0,0 +1,78 @@
+#include "Pack.hh"
+
+#include <algorithm>
+#include <cstring>
+
+#include <glow/common/log.hh>
+#include <glow/common/mapped_file.hh>
+
+using namespace std;
+
+Pack::Pack(string const &packFile, string const &looseDir) : mLooseDir(looseDir) {
+  auto file = glow::util::MappedFile::open(packFile);
+  if (!file) {
+    glow::warning() << packFile << " not found, loading loose files from " << looseDir;
+    return;
+  }
+
+  // the header and index are validated once, entries are trusted afterwards
+  pack::Header header;
+  auto valid = file->size() >= sizeof(header);
+  if (valid) {
+    memcpy(&header, file->data(), sizeof(header));
+    valid = memcmp(header.magic, pack::MAGIC, sizeof(header.magic)) == 0 && header.version == pack::VERSION &&
+            header.entriesOffset % alignof(pack::Entry) == 0 &&
+            header.entriesOffset + header.count * sizeof(pack::Entry) <= header.namesOffset &&
+            header.namesOffset + header.namesSize <= file->size();
+  }
+  if (valid) {
+    auto entries = reinterpret_cast<pack::Entry const *>(file->data() + header.entriesOffset);
+    for (size_t i = 0; i < header.count && valid; i++)
+      valid = entries[i].offset + entries[i].size <= header.entriesOffset &&
+              entries[i].nameOffset + entries[i].nameSize <= header.namesSize;
+#ifdef VERIFY_PACK
+    // the payloads too, a pass over the whole pack (cmake option VERIFY_PACK)
+    for (size_t i = 0; i < header.count && valid; i++)
+      if (pack::hash(file->data() + entries[i].offset, entries[i].size) != entries[i].contentHash) {
+        glow::error() << string(file->data() + header.namesOffset + entries[i].nameOffset, entries[i].nameSize) << " is corrupted in the pack";
+        valid = false;
+      }
+#endif
+  }
+  if (!valid) {
+    glow::error() << packFile << " is not a valid pack, loading loose files from " << looseDir;
+    return;
+  }
+
+  mFile = file;
+  mEntries = reinterpret_cast<pack::Entry const *>(file->data() + header.entriesOffset);
+  mNames = file->data() + header.namesOffset;
+  mCount = header.count;
+}
+
+pack::Entry const *Pack::find(string const &path) const {
+  auto hash = pack::hash(path.data(), path.size());
+  auto end = mEntries + mCount;
+  auto e = lower_bound(mEntries, end, hash, [](pack::Entry const &e, uint64_t h) { return e.pathHash < h; });
+  if (e == end || e->pathHash != hash)
+    return nullptr;
+  if (e->nameSize != path.size() || memcmp(mNames + e->nameOffset, path.data(), path.size()) != 0)
+    return nullptr; // same hash, other file
+  return e;
+}
+
+Blob Pack::get(string const &path) const {
+  if (auto e = find(path)) {
+    return {mFile, mFile->data() + e->offset, e->size};
+  }
+
+  lock_guard<mutex> lock(mMutex);
+  auto &file = mLoose[path];
+  if (!file)
+    file = glow::util::MappedFile::open(mLooseDir + path);
+  if (!file) {
+    glow::error() << path << " is neither packed nor found in " << mLooseDir;
+    return {};
+  }
+  return {file, file->data(), file->size()};
+}
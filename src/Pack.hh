@@ -0,0 +1,49 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "PackFormat.hh"
+
+namespace glow {
+namespace util {
+class MappedFile;
+}
+}
+
+// read-only view of an asset, nothing is copied
+// owner keeps the memory alive (the pack or a loose file mapping), it is valid as long as owner or the Pack lives
+struct Blob {
+  std::shared_ptr<const void> owner;
+  char const *data = nullptr;
+  size_t size = 0;
+
+  explicit operator bool() const { return data != nullptr; }
+};
+
+// assets by path relative to data/ (e.g. "sounds/Shot.wav")
+// from the memory-mapped pack (tools/pack.cc) if it has them, otherwise from a mapping of the loose file
+// identical files are stored once in the pack, so their views share memory, loose files are mapped once
+// thread-safe, used by the loader workers
+class Pack {
+public:
+  // a missing or invalid pack is not an error, everything comes from looseDir then
+  Pack(std::string const &packFile, std::string const &looseDir);
+
+  // empty view (and an error) if the asset is neither in the pack nor a loose file
+  Blob get(std::string const &path) const;
+
+private:
+  pack::Entry const *find(std::string const &path) const;
+
+  std::shared_ptr<glow::util::MappedFile> mFile;
+  pack::Entry const *mEntries = nullptr;
+  char const *mNames = nullptr;
+  size_t mCount = 0;
+  std::string mLooseDir;
+
+  mutable std::mutex mMutex;
+  mutable std::map<std::string, std::shared_ptr<glow::util::MappedFile>> mLoose;
+};
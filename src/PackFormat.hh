@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// asset pack layout, written by tools/pack.cc, read by Pack
+// header | payloads, each aligned | entries, sorted by path hash | names
+// paths are relative to data/ with forward slashes (e.g. "sounds/Shot.wav")
+// identical payloads are stored once, their entries share the offset
+namespace pack {
+const char MAGIC[8] = {'P', 'S', 'Y', 'P', 'A', 'C', 'K', '1'};
+const uint32_t VERSION = 1;
+const uint64_t ALIGNMENT = 64; // of payloads
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t count; // entries
+  uint64_t entriesOffset;
+  uint64_t namesOffset;
+  uint64_t namesSize;
+};
+
+struct Entry {
+  uint64_t pathHash;
+  uint64_t contentHash;
+  uint64_t offset;
+  uint64_t size;
+  uint32_t nameOffset; // in names
+  uint32_t nameSize;
+};
+
+// FNV-1a, for paths and contents
+inline uint64_t hash(const void *data, size_t size) {
+  auto p = (const uint8_t *)data;
+  uint64_t h = 14695981039346656037ull;
+  for (size_t i = 0; i < size; i++)
+    h = (h ^ p[i]) * 1099511628211ull;
+  return h;
+}
+}
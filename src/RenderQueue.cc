@@ -0,0 +1,89 @@
+#include "RenderQueue.hh"
+
+#include <cassert>
+#include <cstring>
+
+#include <glow/objects/Program.hh>
+#include <glow/objects/VertexArray.hh>
+
+uint8_t RenderQueue::addProgram(const glow::SharedProgram &program) {
+  assert(mPrograms.size() < 256);
+  mPrograms.push_back(program);
+  return mPrograms.size() - 1;
+}
+
+uint16_t RenderQueue::addMaterial(uint8_t program, std::vector<std::pair<glow::TextureHandle, glow::SharedTexture>> textures) {
+  assert(mMaterials.size() < 65536);
+  for (auto const &t : textures)
+    assert(t.first.getProgram() == mPrograms[program].get());
+  mMaterials.push_back({program, std::move(textures)});
+  return mMaterials.size() - 1;
+}
+
+void RenderQueue::push(uint8_t pass, uint8_t program, uint16_t material, float depth, glow::VertexArray *mesh, DrawFunc draw) {
+  // positive floats keep their order as uints
+  uint32_t depthBits = 0;
+  if (depth > 0)
+    std::memcpy(&depthBits, &depth, sizeof(depthBits));
+  uint64_t key = (uint64_t)pass << 56 | (uint64_t)program << 48 | (uint64_t)material << 32 | depthBits;
+  mItems.push_back({key, mesh, std::move(draw)});
+}
+
+void RenderQueue::sort() {
+  // LSD radix sort on the indices, 8 bit digits
+  auto n = mItems.size();
+  mOrder.resize(n);
+  mTmp.resize(n);
+  for (uint32_t i = 0; i < n; i++)
+    mOrder[i] = i;
+
+  for (int shift = 0; shift < 64; shift += 8) {
+    size_t count[256] = {};
+    for (auto const &item : mItems)
+      count[(item.key >> shift) & 0xFF]++;
+    if (count[(mItems.empty() ? 0 : mItems[0].key >> shift) & 0xFF] == n)
+      continue; // all the same digit, nothing to do (usual for most of the depth bits)
+
+    size_t offset = 0;
+    for (auto &c : count) {
+      auto tmp = c;
+      c = offset;
+      offset += tmp;
+    }
+    for (auto i : mOrder)
+      mTmp[count[(mItems[i].key >> shift) & 0xFF]++] = i;
+    std::swap(mOrder, mTmp);
+  }
+}
+
+void RenderQueue::submit(uint8_t pass) {
+  assert(mOrder.size() == mItems.size() && "sort() first");
+  auto keyAt = [&](size_t i) { return mItems[mOrder[i]].key; };
+
+  // find the pass, passes are few -> linear is fine
+  size_t i = 0;
+  auto end = mOrder.size();
+  while (i < end && passOf(keyAt(i)) < pass)
+    i++;
+
+  while (i < end && passOf(keyAt(i)) == pass) {
+    auto program = programOf(keyAt(i));
+    auto shader = mPrograms[program]->use();
+    int material = -1;
+
+    while (i < end && passOf(keyAt(i)) == pass && programOf(keyAt(i)) == program) {
+      auto mesh = mItems[mOrder[i]].mesh;
+      auto va = mesh->bind();
+
+      for (; i < end && passOf(keyAt(i)) == pass && programOf(keyAt(i)) == program && mItems[mOrder[i]].mesh == mesh; i++) {
+        auto &item = mItems[mOrder[i]];
+        if (materialOf(item.key) != material) {
+          material = materialOf(item.key);
+          for (auto &t : mMaterials[material].textures)
+            shader.setTexture(t.first, t.second);
+        }
+        item.draw(shader, va);
+      }
+    }
+  }
+}
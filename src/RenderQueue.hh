@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <glow/fwd.hh>
+#include <glow/objects/UniformHandle.hh>
+
+// collects draws, sorts them by a packed key and submits them with as few state changes as possible
+// key (msb to lsb): pass 8 | program 8 | material 16 | depth 32
+// -> one program use() per program run, material textures only rebound on change, VAO only rebound on change
+class RenderQueue {
+public:
+  using DrawFunc = std::function<void(glow::UsedProgram &, glow::BoundVertexArray &)>;
+
+  // a set of textures for one program
+  struct Material {
+    uint8_t program;
+    std::vector<std::pair<glow::TextureHandle, glow::SharedTexture>> textures;
+  };
+
+  // register at init, ids are used in the key
+  uint8_t addProgram(const glow::SharedProgram &program);
+  uint16_t addMaterial(uint8_t program, std::vector<std::pair<glow::TextureHandle, glow::SharedTexture>> textures);
+  static const uint16_t noMaterial = 0; // also used for programs without textures
+
+  void clear() { mItems.clear(); }
+  // depth >= 0 (e.g. distance to camera), smaller is drawn first
+  // draw is called with the program in use and mesh bound
+  void push(uint8_t pass, uint8_t program, uint16_t material, float depth, glow::VertexArray *mesh, DrawFunc draw);
+  void sort();            // once after filling
+  void submit(uint8_t pass); // draws all items of the pass, call after sort
+
+  size_t size() const { return mItems.size(); }
+
+private:
+  struct Item {
+    uint64_t key;
+    glow::VertexArray *mesh;
+    DrawFunc draw;
+  };
+
+  static uint8_t passOf(uint64_t key) { return key >> 56; }
+  static uint8_t programOf(uint64_t key) { return (key >> 48) & 0xFF; }
+  static uint16_t materialOf(uint64_t key) { return (key >> 32) & 0xFFFF; }
+
+  std::vector<glow::SharedProgram> mPrograms;
+  std::vector<Material> mMaterials = std::vector<Material>(1); // 0 = no material
+
+  std::vector<Item> mItems;
+  std::vector<uint32_t> mOrder; // sorted indices into mItems
+  std::vector<uint32_t> mTmp;
+};
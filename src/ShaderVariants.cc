@@ -0,0 +1,47 @@
+#include "ShaderVariants.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include <glow/common/log.hh>
+#include <glow/objects/Program.hh>
+
+using namespace std;
+
+ShaderVariants::ShaderVariants(vector<string> files) : mFiles(move(files)) {}
+
+glow::SharedProgram ShaderVariants::get(vector<string> features) {
+  if (!mParsed) {
+    mParsed = true;
+    for (auto const &file : mFiles) {
+      ifstream f(file);
+      string line;
+      while (getline(f, line)) {
+        auto p = line.find("// features:");
+        if (p == string::npos)
+          continue;
+        stringstream ss(line.substr(p + 12));
+        string feature;
+        while (ss >> feature)
+          mDeclared.push_back(feature);
+      }
+    }
+  }
+
+  sort(features.begin(), features.end());
+  features.erase(unique(features.begin(), features.end()), features.end());
+  auto it = mVariants.find(features);
+  if (it != mVariants.end())
+    return it->second;
+
+  for (auto const &f : features)
+    if (find(mDeclared.begin(), mDeclared.end(), f) == mDeclared.end()) {
+      glow::error() << "shader feature " << f << " is not declared in " << mFiles.front() << " or the other files";
+      return nullptr;
+    }
+
+  auto program = glow::Program::createFromFiles(mFiles, features);
+  mVariants[features] = program;
+  return program;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <glow/fwd.hh>
+
+// shader permutations: one source per geometry type, features are switched with #ifdef
+// a source declares the features it knows in a comment line, e.g. "// features: DEPTH_ONLY"
+// get() compiles a variant on first use (with the features #defined) and then returns the same program,
+// the variants differ in their parsed source, so the program binary cache keeps them apart
+class ShaderVariants {
+public:
+  // files as for glow::Program::createFromFiles
+  explicit ShaderVariants(std::vector<std::string> files);
+
+  // the variant with exactly these features, in any order
+  // features that none of the files declares are an error (typos would silently compile the default)
+  glow::SharedProgram get(std::vector<std::string> features = {});
+
+private:
+  std::vector<std::string> mFiles;
+  std::vector<std::string> mDeclared; // read on first get()
+  bool mParsed = false;
+  std::map<std::vector<std::string>, glow::SharedProgram> mVariants; // by sorted features
+};
@@ -37,9 +37,13 @@ static glm::mat4 aiCast(aiMatrix4x4 const &v) {
 
 // mostly from glow-extras:
 std::shared_ptr<AssimpModel> AssimpModel::load(const std::string &filename) {
+  return load(filename, nullptr, 0);
+}
+
+std::shared_ptr<AssimpModel> AssimpModel::load(const std::string &filename, const char *data, size_t size) {
   std::shared_ptr<AssimpModel> model;
   try {
-    model = std::shared_ptr<AssimpModel>(new AssimpModel(filename));
+    model = std::shared_ptr<AssimpModel>(new AssimpModel(filename, data, size));
   } catch (...) // bad
   {
     return nullptr;
@@ -60,7 +64,7 @@ void AssimpModel::draw(const glow::UsedProgram &shader, double t, bool loop, con
     createVertexArray();
   assert(va);
 
-  debugRenderer.clear();
+  debugRenderer->clear();
 
   auto animation = animations[animationStr]; // might throw
 
@@ -94,7 +98,7 @@ void AssimpModel::draw(const glow::UsedProgram &shader, double t, bool loop, con
       aiQuaternion rot;
       parent.Decompose(scal, rot, parentPos);
       transform.Decompose(scal, rot, pos);
-      debugRenderer.renderLine(aiCast(parentPos), aiCast(pos));
+      debugRenderer->renderLine(aiCast(parentPos), aiCast(pos));
     }*/
 
     // test
@@ -339,8 +343,8 @@ aiMatrix4x4 AssimpModel::getAnimMat(float ticks, aiNodeAnim *anim) {
   return ret;
 }
 
-AssimpModel::AssimpModel(const std::string &filename) : filename(filename) {
-  if (!std::ifstream(filename).good()) {
+AssimpModel::AssimpModel(const std::string &filename, const char *data, size_t size) : filename(filename) {
+  if (!data && !std::ifstream(filename).good()) {
     error() << "Error loading `" << filename << "' with Assimp.";
     error() << "  File not found/not readable";
     throw std::exception();
@@ -371,7 +375,11 @@ AssimpModel::AssimpModel(const std::string &filename) : filename(filename) {
   importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);
 
 
-  scene = importer.ReadFile(filename, flags);
+  if (data) {
+    auto ext = filename.substr(filename.find_last_of('.') + 1);
+    scene = importer.ReadFileFromMemory(data, size, flags, ext.c_str());
+  } else
+    scene = importer.ReadFile(filename, flags);
 
   if (!scene) {
     error() << "Error loading `" << filename << "' with Assimp.";
@@ -558,6 +566,9 @@ void AssimpModel::createVertexArray() {
     return;
   assert(vertexData);
 
+  // creates programs and meshes, so not in the constructor
+  debugRenderer = std::make_unique<glow::debugging::DebugRenderer>();
+
   std::vector<SharedArrayBuffer> abs;
 
   {
@@ -50,7 +50,11 @@ private:
 
 
 public:
-  static SharedAssimpModel load(const std::string &filename); // safe to do in a thread... broken???
+  // safe to do in a thread: no GL here, the vertex array is created on first use
+  // nullptr on errors
+  static SharedAssimpModel load(const std::string &filename);
+  // from memory, filename is for messages and the format (by extension), the memory can be released afterwards
+  static SharedAssimpModel load(const std::string &filename, const char *data, size_t size);
   void draw();                                                // glow::Program should be active
   void draw(const glow::UsedProgram &, double time, bool loop, const std::string &animation);
   std::vector<glm::mat4> getMechBones(const std::string &aba, const std::string &abb, const std::string &at, float ba, double bta, double btb, double tt, float angle);
@@ -59,10 +63,10 @@ public:
   glow::SharedVertexArray getVA();
 
 private:
-  AssimpModel(const std::string &filename);
+  AssimpModel(const std::string &filename, const char *data, size_t size);
   void createVertexArray(); // once on GL thread (automatic)
   aiMatrix4x4 getAnimMat(float t, aiNodeAnim *anim);
 
 public:
-  glow::debugging::DebugRenderer debugRenderer;
+  std::unique_ptr<glow::debugging::DebugRenderer> debugRenderer; // with the vertex array, on the GL thread
 };
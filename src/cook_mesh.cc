@@ -0,0 +1,308 @@
+#include "cook_mesh.hh"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <map>
+
+#include <glow/common/log.hh>
+
+#include <polymesh/Mesh.hh>
+#include <polymesh/algorithms/properties.hh>
+#include <polymesh/fields.hh>
+#include <polymesh/formats/obj.hh>
+
+namespace {
+const char MAGIC[8] = {'P', 'S', 'Y', 'M', 'E', 'S', 'H', '1'};
+
+struct Header {
+  char magic[8];
+  uint32_t vertexSize; // sizeof(MeshVertex), changes with the layout
+  uint32_t vertexCount;
+  uint32_t indexSize;
+  uint32_t indexCount;
+};
+
+// welding compares the bytes, identical tuples are identical vertices
+static_assert(sizeof(MeshVertex) == 11 * sizeof(float), "no padding bytes to compare");
+struct VertexLess {
+  bool operator()(MeshVertex const &a, MeshVertex const &b) const { return std::memcmp(&a, &b, sizeof(MeshVertex)) < 0; }
+};
+
+// Tom Forsyth, "Linear-Speed Vertex Cache Optimisation"
+// greedy: always emits the triangle with the best scored vertices, which are
+// the ones recently used (in the simulated cache) and the ones with few triangles left
+const int CACHE_SIZE = 32;
+
+float vertexScore(int cachePosition, int remaining) {
+  if (remaining == 0)
+    return -1;
+  float score = 0;
+  if (cachePosition >= 0) {
+    if (cachePosition < 3)
+      score = 0.75f; // just used, the triangle before has them anyway
+    else
+      score = std::pow(1 - float(cachePosition - 3) / (CACHE_SIZE - 3), 1.5f);
+  }
+  return score + 2 * std::pow(float(remaining), -0.5f); // finish vertices with few triangles left
+}
+
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount) {
+  auto triangleCount = indices.size() / 3;
+
+  struct Vertex {
+    int cachePosition = -1;
+    int remaining = 0;
+    float score = 0;
+    std::vector<uint32_t> triangles; // not yet emitted
+  };
+  std::vector<Vertex> vertices(vertexCount);
+  for (size_t t = 0; t < triangleCount; t++)
+    for (auto k = 0; k < 3; k++)
+      vertices[indices[3 * t + k]].triangles.push_back(t);
+  for (auto &v : vertices) {
+    v.remaining = v.triangles.size();
+    v.score = vertexScore(-1, v.remaining);
+  }
+
+  std::vector<float> triangleScore(triangleCount);
+  std::vector<bool> emitted(triangleCount, false);
+  for (size_t t = 0; t < triangleCount; t++)
+    for (auto k = 0; k < 3; k++)
+      triangleScore[t] += vertices[indices[3 * t + k]].score;
+
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+  std::vector<uint32_t> cache;
+  size_t scan = 0; // all triangles before are emitted
+  while (result.size() < indices.size()) {
+    // best triangle touching the cache, or the best of all if there is none
+    auto best = triangleCount;
+    for (auto v : cache)
+      for (auto t : vertices[v].triangles)
+        if (best == triangleCount || triangleScore[t] > triangleScore[best])
+          best = t;
+    if (best == triangleCount) {
+      while (emitted[scan])
+        scan++;
+      for (auto t = scan; t < triangleCount; t++)
+        if (!emitted[t] && (best == triangleCount || triangleScore[t] > triangleScore[best]))
+          best = t;
+    }
+
+    emitted[best] = true;
+    std::vector<uint32_t> newCache;
+    for (auto k = 0; k < 3; k++) {
+      auto i = indices[3 * best + k];
+      result.push_back(i);
+      newCache.push_back(i);
+      auto &ts = vertices[i].triangles;
+      ts.erase(std::find(ts.begin(), ts.end(), best));
+      vertices[i].remaining--;
+    }
+    for (auto v : cache)
+      if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+        newCache.push_back(v);
+
+    // rescore everything that was in the cache before or is now, then their triangles
+    for (size_t p = 0; p < newCache.size(); p++) {
+      auto &v = vertices[newCache[p]];
+      v.cachePosition = p < CACHE_SIZE ? p : -1;
+      auto score = vertexScore(v.cachePosition, v.remaining);
+      auto delta = score - v.score;
+      v.score = score;
+      for (auto t : v.triangles)
+        triangleScore[t] += delta;
+    }
+    if (newCache.size() > CACHE_SIZE)
+      newCache.resize(CACHE_SIZE);
+    cache = std::move(newCache);
+  }
+  indices = std::move(result);
+}
+}
+
+bool cook_mesh_from_obj(std::istream &in, std::string const &filename, bool interpolate_tangents, CookedMesh &mesh) {
+  pm::Mesh m;
+  pm::obj_reader<float> obj_reader(in, m);
+  if (obj_reader.error_faces() > 0)
+    glow::warning() << filename << " contains " << obj_reader.error_faces() << " faces that could not be added";
+  if (m.faces().empty()) {
+    glow::error() << filename << " contains no faces";
+    return false;
+  }
+
+  auto normals = obj_reader.get_normals().map([](std::array<float, 3> const &t) { return glm::vec3(t[0], t[1], t[2]); });
+  auto texcoord = obj_reader.get_tex_coords().map([](std::array<float, 3> const &t) { return glm::vec2(t[0], t[1]); });
+  auto pos = obj_reader.get_positions().map([](std::array<float, 4> const &t) { return glm::vec3(t[0], t[1], t[2]); });
+  auto tangents = m.halfedges().make_attribute_with_default(glm::vec3(0, 0, 0));
+  auto interpolated_tangents = m.vertices().make_attribute_with_default(glm::vec3(0, 0, 0));
+
+  auto mesh_has_texcoords = obj_reader.has_valid_texcoords();
+  auto mesh_has_normals = obj_reader.has_valid_normals();
+
+  if (!mesh_has_normals) {
+    // Compute normals
+    auto vnormals = pm::vertex_normals_by_area(m, pos);
+    for (auto h : m.halfedges())
+      normals[h] = vnormals[h.vertex_to()];
+  }
+
+  if (!mesh_has_texcoords) {
+    glow::warning() << "Mesh " << filename << " does not have texture coordinates. Cannot compute tangents.";
+    for (auto &t : tangents) {
+      auto one_over_sqrt3 = 0.57735f;
+      t = {one_over_sqrt3, one_over_sqrt3, one_over_sqrt3};
+    }
+  } else {
+    // creation of tangents for triangle meshes
+    auto faceTangents = m.faces().make_attribute<glm::vec3>();
+    for (auto f : m.faces()) {
+      glm::vec3 p[3];
+      glm::vec2 t[3];
+      int cnt = 0;
+      for (auto h : f.halfedges()) {
+        auto v = h.vertex_to();
+        p[cnt] = pos[v];
+        t[cnt] = texcoord[h];
+        ++cnt;
+
+        if (cnt > 2)
+          break;
+      }
+
+      auto p10 = p[1] - p[0];
+      auto p20 = p[2] - p[0];
+
+      auto t10 = t[1] - t[0];
+      auto t20 = t[2] - t[0];
+
+      auto u10 = t10.x;
+      auto u20 = t20.x;
+      auto v10 = t10.y;
+      auto v20 = t20.y;
+
+      // necessary?
+      float dir = (u20 * v10 - u10 * v20) < 0 ? -1 : 1;
+
+      // sanity check
+      if (u20 * v10 == u10 * v20) {
+        // glow::warning() << "Warning: Creating bad tangent";
+        u20 = 1;
+        u10 = 0;
+        v10 = 1;
+        v20 = 0;
+      }
+      auto tangent = dir * (p20 * v10 - p10 * v20);
+      faceTangents[f] = tangent;
+    }
+
+
+    // compute halfedge tangents / interpolated vertex tangents
+    for (auto f : m.faces()) {
+      for (auto h : f.halfedges()) {
+        auto halfedge_tangent = faceTangents[f] - normals[h] * pm::field3<glm::vec3>::dot(faceTangents[f], normals[h]);
+        tangents[h] += halfedge_tangent;
+
+        if (interpolate_tangents) {
+          auto v = h.vertex_to();
+          interpolated_tangents[v] += halfedge_tangent;
+        }
+      }
+    }
+  }
+
+  // corners with the same attributes become one vertex, faces become fans
+  mesh.vertices.clear();
+  mesh.indices.clear();
+  std::map<MeshVertex, uint32_t, VertexLess> welded;
+  std::vector<uint32_t> face;
+  for (auto f : m.faces()) {
+    face.clear();
+    for (auto h : f.halfedges()) {
+      auto v = h.vertex_to();
+      auto t = interpolate_tangents ? interpolated_tangents[v] : tangents[h];
+      auto l = pm::field3<glm::vec3>::length(t);
+      if (l > 0)
+        t /= l;
+
+      MeshVertex mv;
+      mv.position = pos[v];
+      mv.normal = normals[h];
+      mv.tangent = t;
+      mv.texCoord = texcoord[h];
+      auto it = welded.emplace(mv, (uint32_t)mesh.vertices.size());
+      if (it.second)
+        mesh.vertices.push_back(mv);
+      face.push_back(it.first->second);
+    }
+    for (size_t i = 2; i < face.size(); i++)
+      mesh.indices.insert(mesh.indices.end(), {face[0], face[i - 1], face[i]});
+  }
+
+  optimizeVertexCache(mesh.indices, mesh.vertices.size());
+
+  // vertices in the order the triangles use them, so fetches go forward through memory
+  std::vector<uint32_t> remap(mesh.vertices.size(), UINT32_MAX);
+  std::vector<MeshVertex> ordered;
+  ordered.reserve(mesh.vertices.size());
+  for (auto &i : mesh.indices) {
+    if (remap[i] == UINT32_MAX) {
+      remap[i] = ordered.size();
+      ordered.push_back(mesh.vertices[i]);
+    }
+    i = remap[i];
+  }
+  mesh.vertices = std::move(ordered);
+  return true;
+}
+
+bool write_cooked_mesh(std::string const &filename, CookedMesh const &mesh) {
+  Header header;
+  std::memcpy(header.magic, MAGIC, sizeof(header.magic));
+  header.vertexSize = sizeof(MeshVertex);
+  header.vertexCount = mesh.vertices.size();
+  header.indexSize = mesh.vertices.size() <= 65536 ? 2 : 4;
+  header.indexCount = mesh.indices.size();
+
+  std::ofstream out(filename, std::ios::binary);
+  out.write((char const *)&header, sizeof(header));
+  out.write((char const *)mesh.vertices.data(), mesh.vertices.size() * sizeof(MeshVertex));
+  if (header.indexSize == 2) {
+    std::vector<uint16_t> indices(mesh.indices.begin(), mesh.indices.end());
+    out.write((char const *)indices.data(), indices.size() * 2);
+  } else
+    out.write((char const *)mesh.indices.data(), mesh.indices.size() * 4);
+  if (!out.good()) {
+    glow::error() << "cannot write " << filename;
+    return false;
+  }
+  return true;
+}
+
+bool read_cooked_mesh(char const *data, size_t size, std::string const &filename, CookedMeshView &view) {
+  Header header;
+  if (size < sizeof(header)) {
+    glow::error() << filename << " is not a cooked mesh";
+    return false;
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, MAGIC, sizeof(header.magic)) != 0 || header.vertexSize != sizeof(MeshVertex)) {
+    glow::error() << filename << " is not a cooked mesh or from an older version, cook it again";
+    return false;
+  }
+  auto vertexBytes = size_t(header.vertexCount) * sizeof(MeshVertex);
+  if ((header.indexSize != 2 && header.indexSize != 4) || sizeof(header) + vertexBytes + size_t(header.indexCount) * header.indexSize > size) {
+    glow::error() << filename << " is truncated";
+    return false;
+  }
+
+  view.vertices = data + sizeof(header);
+  view.vertexCount = header.vertexCount;
+  view.indices = data + sizeof(header) + vertexBytes;
+  view.indexCount = header.indexCount;
+  view.indexSize = header.indexSize;
+  return true;
+}
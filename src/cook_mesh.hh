@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+// mesh cooking, shared by tools/cook_mesh.cc and load_mesh (no GL in here)
+// .obj -> triangles over welded vertices (identical attribute tuples are stored once),
+// reordered for the post-transform vertex cache, vertices in order of first use, interleaved
+
+struct MeshVertex {
+  glm::vec3 position;
+  glm::vec3 normal;
+  glm::vec3 tangent;
+  glm::vec2 texCoord;
+};
+
+struct CookedMesh {
+  std::vector<MeshVertex> vertices;
+  std::vector<uint32_t> indices; // triangles
+};
+
+// by default, vertex tangents are interpolated from face tangents,
+// for flat shaded objects (e.g. cube) interpolate_tangents should be false
+bool cook_mesh_from_obj(std::istream &in, std::string const &filename, bool interpolate_tangents, CookedMesh &mesh);
+
+// cooked files: header, vertices, indices (16 bit if the vertices allow it)
+bool write_cooked_mesh(std::string const &filename, CookedMesh const &mesh);
+
+// points into data, nothing is copied
+struct CookedMeshView {
+  void const *vertices = nullptr; // MeshVertex
+  uint32_t vertexCount = 0;
+  void const *indices = nullptr;
+  uint32_t indexCount = 0;
+  uint32_t indexSize = 0; // 2 or 4 bytes
+};
+bool read_cooked_mesh(char const *data, size_t size, std::string const &filename, CookedMeshView &view);
@@ -1,16 +1,31 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <glow/fwd.hh>
 
-/// load a mesh from a .obj file
-/// vertex layout:
+/// load a mesh cooked by tools/cook_mesh.cc from memory, uploaded straight from there
+/// vertex layout (one interleaved buffer, see MeshVertex in cook_mesh.hh):
 ///     in vec3 aPosition;
 ///     in vec3 aNormal;
 ///     in vec3 aTangent;
 ///     in vec2 aTexCoord;
-///
-/// by default, computed vertex tangents are interpolated from face tangents,
-/// for flat shaded objects (e.g. cube) this flag should be set to false
-glow::SharedVertexArray load_mesh_from_obj(std::string const &filename, bool interpolate_tangents = true);
+/// indexed triangles, welded and ordered for the vertex cache
+glow::SharedVertexArray load_cooked_mesh(char const *data, size_t size, std::string const &filename);
+
+/// draw parameters of one mesh in a merged vertex array (DrawElementsIndirectCommand without the instances)
+struct MeshRange {
+  uint32_t indexCount = 0;
+  uint32_t firstIndex = 0;
+  int32_t baseVertex = 0;
+};
+
+/// several cooked meshes (data, size) in one vertex and one index buffer, e.g. to draw them with one multi-draw
+/// ranges[i] is mesh i, its indices stay relative to its own vertices (baseVertex)
+/// name is for messages
+glow::SharedVertexArray load_cooked_meshes(std::vector<std::pair<char const *, size_t>> const &meshes, std::string const &name,
+                                           std::vector<MeshRange> &ranges);
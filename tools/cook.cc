@@ -0,0 +1,506 @@
+// texture cooker: decodes the PNGs once at build time into block compressed DDS files with all mipmaps
+// the game memory-maps them and uploads without decoding (see glow::TextureData::loadWithDDS)
+//
+// usage: cook <manifest>, paths are relative to the manifest
+// manifest lines: <format> <output name> <input>... (# comments)
+//   bc1, bc1-srgb  opaque color
+//   bc3, bc3-srgb  color with alpha
+//   bc4            red
+//   normal         bc5, xy of a normal map, z is reconstructed in the shader
+//   pack-rg        bc5, red of the first input in r, red of the second in g (e.g. metallic, roughness)
+// 6 inputs make a cube map (+x -x +y -y +z -z)
+// <format>-array makes a texture array, one layer per input (pack-rg: per pair of inputs),
+//   layers are resampled to the size of the largest
+// <format>-ggx prefilters a cube map for GGX reflections: level l is roughness l / (GGX_LEVELS - 1),
+//   level 0 is the input (mirror, and the sky), there are no levels beyond
+// outputs go to cooked/<output name>.dds and are skipped if newer than the manifest and inputs
+// outputs with missing inputs are skipped with a warning, like missing files in tools/pack.cc,
+//   except for normal-array: a missing layer is flat (+z) so the other layers still work
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+#ifdef _MSC_VER
+#include <direct.h>
+#endif
+
+#include <glm/glm.hpp>
+
+#include <lodepng/lodepng.h>
+
+#define STB_DXT_IMPLEMENTATION
+#include <stb/stb_dxt.h>
+
+using namespace std;
+
+namespace {
+
+enum class Format { BC1, BC3, BC4, BC5 };
+
+struct Recipe {
+  Format format;
+  bool srgb = false;
+  bool normal = false;
+  bool packRG = false;
+  bool array = false;
+  bool ggx = false;
+};
+
+const int GGX_LEVELS = 6;   // same as SPECULAR_LODS + 1 in data/shaders/fuse.glsl
+const int GGX_SAMPLES = 64; // per texel, from the mip that matches the solid angle of a sample
+
+// rgba in [0, 1], linear for srgb inputs
+struct Image {
+  int width = 0, height = 0;
+  vector<float> px;
+
+  float *at(int x, int y) { return &px[(y * width + x) * 4]; }
+};
+
+float toLinear(float c) { return c <= 0.04045f ? c / 12.92f : pow((c + 0.055f) / 1.055f, 2.4f); }
+float toSRGB(float c) { return c <= 0.0031308f ? c * 12.92f : 1.055f * pow(c, 1 / 2.4f) - 0.055f; }
+uint8_t toByte(float c) { return (uint8_t)lround(min(max(c, 0.f), 1.f) * 255); }
+
+int64_t modificationTime(const string &file) {
+  struct stat attr;
+  if (stat(file.c_str(), &attr) != 0)
+    return -1;
+  return attr.st_mtime;
+}
+
+bool load(const string &file, const Recipe &r, Image &img) {
+  vector<unsigned char> data;
+  unsigned w, h;
+  if (auto err = lodepng::decode(data, w, h, file)) {
+    cerr << file << ": " << lodepng_error_text(err) << endl;
+    return false;
+  }
+  img.width = w;
+  img.height = h;
+  img.px.resize(data.size());
+  for (size_t i = 0; i < data.size(); i++) {
+    img.px[i] = data[i] / 255.f;
+    if (r.srgb && i % 4 != 3)
+      img.px[i] = toLinear(img.px[i]);
+  }
+  return true;
+}
+
+// box filter, odd sizes clamp
+Image downsample(Image &src, const Recipe &r) {
+  Image dst;
+  dst.width = max(1, src.width / 2);
+  dst.height = max(1, src.height / 2);
+  dst.px.resize(dst.width * dst.height * 4);
+  for (int y = 0; y < dst.height; y++)
+    for (int x = 0; x < dst.width; x++) {
+      auto d = dst.at(x, y);
+      for (int j = 0; j < 4; j++) {
+        auto s = src.at(min(x * 2 + (j & 1), src.width - 1), min(y * 2 + (j >> 1), src.height - 1));
+        for (int c = 0; c < 4; c++)
+          d[c] += s[c] / 4;
+      }
+      if (r.normal) {
+        // average of directions, not of colors
+        float n[3] = {d[0] * 2 - 1, d[1] * 2 - 1, d[2] * 2 - 1};
+        auto len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (len > 1e-6f)
+          for (int c = 0; c < 3; c++)
+            d[c] = n[c] / len * .5f + .5f;
+      }
+    }
+  return dst;
+}
+
+// cube map faces in GL order (+x -x +y -y +z -z), s and t in [-1, 1], t down the image
+glm::vec3 cubeDir(int face, float s, float t) {
+  switch (face) {
+  case 0:
+    return {1, -t, -s};
+  case 1:
+    return {-1, -t, s};
+  case 2:
+    return {s, 1, t};
+  case 3:
+    return {s, -1, -t};
+  case 4:
+    return {s, -t, 1};
+  default:
+    return {-s, -t, -1};
+  }
+}
+
+// bilinear in one level (faces of the same size), edges clamp
+glm::vec3 sampleCube(vector<Image> &faces, glm::vec3 d) {
+  auto a = glm::abs(d);
+  int face;
+  float s, t, m;
+  if (a.x >= a.y && a.x >= a.z) {
+    face = d.x > 0 ? 0 : 1;
+    m = a.x;
+    s = d.x > 0 ? -d.z : d.z;
+    t = -d.y;
+  } else if (a.y >= a.z) {
+    face = d.y > 0 ? 2 : 3;
+    m = a.y;
+    s = d.x;
+    t = d.y > 0 ? d.z : -d.z;
+  } else {
+    face = d.z > 0 ? 4 : 5;
+    m = a.z;
+    s = d.z > 0 ? d.x : -d.x;
+    t = -d.y;
+  }
+  auto &img = faces[face];
+  auto x = min(max((s / m * .5f + .5f) * img.width - .5f, 0.f), img.width - 1.f);
+  auto y = min(max((t / m * .5f + .5f) * img.height - .5f, 0.f), img.height - 1.f);
+  int x0 = (int)x, y0 = (int)y;
+  int x1 = min(x0 + 1, img.width - 1), y1 = min(y0 + 1, img.height - 1);
+  auto fx = x - x0, fy = y - y0;
+  auto px = [&](int x, int y) {
+    auto p = img.at(x, y);
+    return glm::vec3(p[0], p[1], p[2]);
+  };
+  return glm::mix(glm::mix(px(x0, y0), px(x1, y0), fx), glm::mix(px(x0, y1), px(x1, y1), fx), fy);
+}
+
+// GGX prefiltered radiance for the reflection direction N (= V), split sum approximation (Karis 2013)
+// importance sampled, every sample reads the mip that covers its solid angle (Colbert, Krivanek 2007)
+void prefilterGGX(vector<vector<Image>> &mips, float roughness, vector<Image> &dst) {
+  const float pi = 3.14159265f;
+  auto alpha = roughness * roughness; // as in fuse.glsl
+  auto texelAngle = 4 * pi / (6.f * mips[0][0].width * mips[0][0].width);
+  auto filterFace = [&](int face) {
+    auto &img = dst[face];
+    for (int y = 0; y < img.height; y++)
+      for (int x = 0; x < img.width; x++) {
+        auto N = glm::normalize(cubeDir(face, (x + .5f) / img.width * 2 - 1, (y + .5f) / img.height * 2 - 1));
+        auto up = abs(N.z) < .999f ? glm::vec3(0, 0, 1) : glm::vec3(1, 0, 0);
+        auto tx = glm::normalize(glm::cross(up, N));
+        auto ty = glm::cross(N, tx);
+
+        glm::vec3 sum(0);
+        float weight = 0;
+        for (int i = 0; i < GGX_SAMPLES; i++) {
+          // hammersley
+          auto bits = (uint32_t)i;
+          bits = (bits << 16u) | (bits >> 16u);
+          bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+          bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+          bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+          bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+          auto u = float(i) / GGX_SAMPLES, v = bits * 2.3283064365386963e-10f;
+
+          auto phi = 2 * pi * u;
+          auto cosTheta = sqrt((1 - v) / (1 + (alpha * alpha - 1) * v));
+          auto sinTheta = sqrt(1 - cosTheta * cosTheta);
+          auto H = tx * (sinTheta * cos(phi)) + ty * (sinTheta * sin(phi)) + N * cosTheta;
+          auto L = 2 * glm::dot(N, H) * H - N;
+          auto dotNL = glm::dot(N, L);
+          if (dotNL <= 0)
+            continue;
+
+          // pdf of L with V = N: D / 4
+          auto denom = cosTheta * cosTheta * (alpha * alpha - 1) + 1;
+          auto D = alpha * alpha / (pi * denom * denom);
+          auto sampleAngle = 1 / (GGX_SAMPLES * D / 4 + 1e-6f);
+          auto lod = glm::clamp(.5f * log2(sampleAngle / texelAngle) + 1, 0.f, mips.size() - 1.f);
+          auto l0 = (int)lod;
+          auto l1 = min(l0 + 1, (int)mips.size() - 1);
+          sum += glm::mix(sampleCube(mips[l0], L), sampleCube(mips[l1], L), lod - l0) * dotNL;
+          weight += dotNL;
+        }
+        auto c = sum / max(weight, 1e-6f);
+        auto d = img.at(x, y);
+        d[0] = c.x;
+        d[1] = c.y;
+        d[2] = c.z;
+        d[3] = 1;
+      }
+  };
+
+  // the faces are independent and this is by far the slowest recipe
+  vector<thread> threads;
+  for (int face = 0; face < 6; face++)
+    threads.emplace_back(filterFace, face);
+  for (auto &t : threads)
+    t.join();
+}
+
+// bilinear, for array layers of different sizes
+Image resample(Image &src, int width, int height, const Recipe &r) {
+  Image dst;
+  dst.width = width;
+  dst.height = height;
+  dst.px.resize(width * height * 4);
+  for (int y = 0; y < height; y++)
+    for (int x = 0; x < width; x++) {
+      auto sx = min(max((x + .5f) * src.width / width - .5f, 0.f), src.width - 1.f);
+      auto sy = min(max((y + .5f) * src.height / height - .5f, 0.f), src.height - 1.f);
+      int x0 = (int)sx, y0 = (int)sy;
+      int x1 = min(x0 + 1, src.width - 1), y1 = min(y0 + 1, src.height - 1);
+      auto fx = sx - x0, fy = sy - y0;
+      auto d = dst.at(x, y);
+      for (int c = 0; c < 4; c++)
+        d[c] = (src.at(x0, y0)[c] * (1 - fx) + src.at(x1, y0)[c] * fx) * (1 - fy) //
+               + (src.at(x0, y1)[c] * (1 - fx) + src.at(x1, y1)[c] * fx) * fy;
+      if (r.normal) {
+        float n[3] = {d[0] * 2 - 1, d[1] * 2 - 1, d[2] * 2 - 1};
+        auto len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (len > 1e-6f)
+          for (int c = 0; c < 3; c++)
+            d[c] = n[c] / len * .5f + .5f;
+      }
+    }
+  return dst;
+}
+
+void compress(Image &img, const Recipe &r, vector<char> &out) {
+  for (int by = 0; by < img.height; by += 4)
+    for (int bx = 0; bx < img.width; bx += 4) {
+      uint8_t rgba[16 * 4], rg[16 * 2], red[16];
+      for (int i = 0; i < 16; i++) {
+        auto p = img.at(min(bx + i % 4, img.width - 1), min(by + i / 4, img.height - 1));
+        for (int c = 0; c < 4; c++)
+          rgba[i * 4 + c] = toByte(r.srgb && c != 3 ? toSRGB(p[c]) : p[c]);
+        rg[i * 2] = red[i] = rgba[i * 4];
+        rg[i * 2 + 1] = rgba[i * 4 + 1];
+      }
+
+      uint8_t block[16];
+      auto size = 16;
+      switch (r.format) {
+      case Format::BC1:
+        stb_compress_dxt_block(block, rgba, 0, STB_DXT_HIGHQUAL);
+        size = 8;
+        break;
+      case Format::BC3:
+        stb_compress_dxt_block(block, rgba, 1, STB_DXT_HIGHQUAL);
+        break;
+      case Format::BC4:
+        stb_compress_bc4_block(block, red);
+        size = 8;
+        break;
+      case Format::BC5:
+        stb_compress_bc5_block(block, rg);
+        break;
+      }
+      out.insert(out.end(), (char *)block, (char *)block + size);
+    }
+}
+
+uint32_t dxgiFormat(const Recipe &r) {
+  switch (r.format) {
+  case Format::BC1:
+    return r.srgb ? 72 : 71;
+  case Format::BC3:
+    return r.srgb ? 78 : 77;
+  case Format::BC4:
+    return 80;
+  case Format::BC5:
+    return 83;
+  }
+  return 0;
+}
+
+// DDS with the DX10 header, faces (or layers) with their mip chains
+void writeDDS(const string &file, const Recipe &r, int width, int height, int levels, bool cube, int layers, const vector<char> &data) {
+  uint32_t header[31] = {};
+  header[0] = 124;                                        // size
+  header[1] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000;         // caps, height, width, pixelformat, mipmapcount
+  header[2] = height;
+  header[3] = width;
+  header[6] = levels;
+  header[18] = 32;                                        // pixelformat size
+  header[19] = 0x4;                                       // fourcc
+  header[20] = 'D' | 'X' << 8 | '1' << 16 | '0' << 24;
+  header[26] = 0x1000 | 0x400000 | 0x8;                   // texture, mipmap, complex
+  header[27] = cube ? 0x200 | 0xFC00 : 0;                 // cubemap, all faces
+  uint32_t dx10[5] = {dxgiFormat(r), 3, cube ? 0x4u : 0u, (uint32_t)layers, 0}; // texture2d
+
+  ofstream f(file, ios::binary);
+  f.write("DDS ", 4);
+  f.write((char *)header, sizeof(header));
+  f.write((char *)dx10, sizeof(dx10));
+  f.write(data.data(), data.size());
+}
+
+bool cook(const Recipe &r, const vector<string> &inputs, const string &output) {
+  auto perImage = r.packRG ? 2u : 1u;
+  auto wrongCount = r.array ? inputs.empty() || inputs.size() % perImage != 0 : inputs.size() != perImage && (r.packRG || inputs.size() != 6);
+  wrongCount |= r.ggx && inputs.size() != 6;
+  if (wrongCount) {
+    cerr << output << ": wrong number of inputs" << endl;
+    return false;
+  }
+
+  vector<Image> faces;
+  for (size_t in = 0; in < inputs.size(); in += perImage) {
+    faces.emplace_back();
+    auto &a = faces.back();
+    if (r.array && r.normal && modificationTime(inputs[in]) < 0) {
+      a.width = a.height = 1; // resampled to the other layers
+      a.px = {.5f, .5f, 1, 1};
+      continue;
+    }
+    if (!load(inputs[in], r, a))
+      return false;
+    if (r.packRG) {
+      Image b;
+      if (!load(inputs[in + 1], r, b))
+        return false;
+      if (a.width != b.width || a.height != b.height) {
+        cerr << output << ": inputs differ in size" << endl;
+        return false;
+      }
+      for (size_t i = 0; i < a.px.size(); i += 4)
+        a.px[i + 1] = b.px[i];
+    }
+  }
+
+  auto width = faces[0].width, height = faces[0].height;
+  if (r.array) {
+    for (auto const &img : faces) {
+      width = max(width, img.width);
+      height = max(height, img.height);
+    }
+    for (auto &img : faces)
+      if (img.width != width || img.height != height)
+        img = resample(img, width, height, r);
+  }
+  auto levels = 1;
+  while ((width >> levels) > 0 || (height >> levels) > 0)
+    levels++;
+
+  vector<char> data;
+  if (r.ggx) {
+    // the full chain to sample from, then the roughness levels
+    vector<vector<Image>> mips = {faces};
+    for (int l = 1; l < levels; l++) {
+      mips.emplace_back();
+      for (auto &img : mips[l - 1])
+        mips[l].push_back(downsample(img, r));
+    }
+    levels = min(levels, GGX_LEVELS);
+    vector<vector<Image>> prefiltered = {faces};
+    for (int l = 1; l < levels; l++) {
+      prefiltered.push_back(mips[l]); // size
+      prefilterGGX(mips, float(l) / (GGX_LEVELS - 1), prefiltered[l]);
+    }
+    for (int face = 0; face < 6; face++)
+      for (int l = 0; l < levels; l++)
+        compress(prefiltered[l][face], r, data);
+  } else
+    for (auto &img : faces)
+      for (int l = 0; l < levels; l++) {
+        compress(img, r, data);
+        if (l + 1 < levels)
+          img = downsample(img, r);
+      }
+
+  writeDDS(output, r, width, height, levels, !r.array && faces.size() == 6, r.array ? faces.size() : 1, data);
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    cerr << "usage: cook <manifest>" << endl;
+    return 1;
+  }
+
+  string manifest = argv[1];
+  auto dir = manifest.substr(0, manifest.find_last_of("/\\") + 1);
+  auto outDir = dir + "cooked/";
+#ifdef _MSC_VER
+  _mkdir(outDir.c_str());
+#else
+  mkdir(outDir.c_str(), 0755);
+#endif
+
+  ifstream f(manifest);
+  if (!f.good()) {
+    cerr << "cannot open " << manifest << endl;
+    return 1;
+  }
+
+  auto manifestTime = modificationTime(manifest);
+  auto ok = true;
+  string line;
+  while (getline(f, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    // inputs may contain spaces ("Health bar0.png"), so they are separated by tabs
+    vector<string> tokens;
+    stringstream ss(line);
+    string token;
+    while (getline(ss, token, '\t'))
+      if (!token.empty())
+        tokens.push_back(token);
+    if (tokens.size() < 3) {
+      cerr << "malformed line: " << line << endl;
+      ok = false;
+      continue;
+    }
+
+    Recipe r;
+    auto fmt = tokens[0];
+    r.array = fmt.size() > 6 && fmt.compare(fmt.size() - 6, 6, "-array") == 0;
+    if (r.array)
+      fmt.resize(fmt.size() - 6);
+    r.ggx = fmt.size() > 4 && fmt.compare(fmt.size() - 4, 4, "-ggx") == 0;
+    if (r.ggx)
+      fmt.resize(fmt.size() - 4);
+    if (fmt == "bc1" || fmt == "bc1-srgb")
+      r.format = Format::BC1;
+    else if (fmt == "bc3" || fmt == "bc3-srgb")
+      r.format = Format::BC3;
+    else if (fmt == "bc4")
+      r.format = Format::BC4;
+    else if (fmt == "normal" || fmt == "pack-rg")
+      r.format = Format::BC5;
+    else {
+      cerr << "unknown format " << fmt << endl;
+      ok = false;
+      continue;
+    }
+    r.srgb = fmt.find("-srgb") != string::npos;
+    r.normal = fmt == "normal";
+    r.packRG = fmt == "pack-rg";
+
+    auto output = outDir + tokens[1] + ".dds";
+    vector<string> inputs;
+    auto newest = manifestTime;
+    auto missing = false;
+    for (size_t i = 2; i < tokens.size(); i++) {
+      inputs.push_back(dir + tokens[i]);
+      auto time = modificationTime(inputs.back());
+      if (time < 0 && r.array && r.normal)
+        cerr << "warning: " << inputs.back() << " is missing, its layer of " << output << " is flat" << endl;
+      else if (time < 0) {
+        cerr << "warning: " << inputs.back() << " is missing, " << output << " is not cooked" << endl;
+        missing = true;
+      }
+      newest = max(newest, time);
+    }
+    if (missing)
+      continue; // not an error, the game reports the texture when it loads it
+    if (modificationTime(output) >= newest)
+      continue; // up to date
+
+    cout << "cooking " << output << endl;
+    ok &= cook(r, inputs, output);
+  }
+
+  return ok ? 0 : 1;
+}
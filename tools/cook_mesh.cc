@@ -0,0 +1,106 @@
+// mesh cooker: turns .obj files into indexed, vertex cache ordered, interleaved binaries (see src/cook_mesh.hh)
+// the game uploads them without parsing (see load_cooked_mesh)
+//
+// usage: cook-mesh <manifest>, paths are relative to the manifest
+// manifest lines: <tangents> <output name> <input> (# comments)
+//   smooth  tangents interpolated over the faces of a vertex
+//   flat    tangents per face (e.g. cube)
+// outputs go to cooked/<output name>.mesh and are skipped if newer than the manifest and input
+// outputs with a missing input are skipped with a warning, like missing files in tools/pack.cc
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#ifdef _MSC_VER
+#include <direct.h>
+#endif
+
+#include "cook_mesh.hh"
+
+using namespace std;
+
+namespace {
+
+int64_t modificationTime(const string &file) {
+  struct stat attr;
+  if (stat(file.c_str(), &attr) != 0)
+    return -1;
+  return attr.st_mtime;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    cerr << "usage: cook-mesh <manifest>" << endl;
+    return 1;
+  }
+
+  string manifest = argv[1];
+  auto dir = manifest.substr(0, manifest.find_last_of("/\\") + 1);
+  auto outDir = dir + "cooked/";
+#ifdef _MSC_VER
+  _mkdir(outDir.c_str());
+#else
+  mkdir(outDir.c_str(), 0755);
+#endif
+
+  ifstream f(manifest);
+  if (!f.good()) {
+    cerr << "cannot open " << manifest << endl;
+    return 1;
+  }
+
+  auto manifestTime = modificationTime(manifest);
+  auto ok = true;
+  string line;
+  while (getline(f, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    vector<string> tokens;
+    stringstream ss(line);
+    string token;
+    while (getline(ss, token, '\t'))
+      if (!token.empty())
+        tokens.push_back(token);
+    if (tokens.size() != 3 || (tokens[0] != "smooth" && tokens[0] != "flat")) {
+      cerr << "malformed line: " << line << endl;
+      ok = false;
+      continue;
+    }
+
+    auto input = dir + tokens[2];
+    auto output = outDir + tokens[1] + ".mesh";
+    auto inputTime = modificationTime(input);
+    if (inputTime < 0) {
+      cerr << "warning: " << input << " is missing, " << output << " is not cooked" << endl;
+      continue; // not an error, the game reports the mesh when it loads it
+    }
+    if (modificationTime(output) >= max(manifestTime, inputTime))
+      continue; // up to date
+
+    ifstream in(input);
+    if (!in.good()) {
+      cerr << "cannot open " << input << endl;
+      ok = false;
+      continue;
+    }
+
+    cout << "cooking " << output << endl;
+    CookedMesh mesh;
+    if (!cook_mesh_from_obj(in, input, tokens[0] == "smooth", mesh) || !write_cooked_mesh(output, mesh)) {
+      remove(output.c_str());
+      ok = false;
+      continue;
+    }
+    cout << "  " << mesh.vertices.size() << " vertices, " << mesh.indices.size() / 3 << " triangles" << endl;
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,173 @@
+// asset packer: writes the files listed in a manifest into one pack (format in src/PackFormat.hh)
+// the game maps the pack once and reads assets from it without copying (see src/Pack.hh)
+//
+// usage: pack <manifest> <output>, paths are relative to the manifest and stored like that
+// manifest lines: <path> (# comments)
+// payloads are stored in manifest order, so what is loaded together should be listed together
+// identical files are stored once, missing files are skipped with a warning (the game falls back to loose files)
+// the output is skipped if newer than the manifest and all inputs
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "PackFormat.hh"
+
+using namespace std;
+
+namespace {
+
+int64_t modificationTime(const string &file) {
+  struct stat attr;
+  if (stat(file.c_str(), &attr) != 0)
+    return -1;
+  return attr.st_mtime;
+}
+
+struct Input {
+  string path;
+  pack::Entry entry;
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    cerr << "usage: pack <manifest> <output>" << endl;
+    return 1;
+  }
+
+  string manifest = argv[1];
+  string output = argv[2];
+  auto dir = manifest.substr(0, manifest.find_last_of("/\\") + 1);
+
+  ifstream f(manifest);
+  if (!f.good()) {
+    cerr << "cannot open " << manifest << endl;
+    return 1;
+  }
+
+  vector<string> paths;
+  auto newest = modificationTime(manifest);
+  string line;
+  while (getline(f, line)) {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    if (line.empty() || line[0] == '#')
+      continue;
+    auto time = modificationTime(dir + line);
+    if (time < 0) {
+      cerr << "warning: " << dir + line << " is missing, not packed" << endl;
+      continue;
+    }
+    paths.push_back(line);
+    newest = max(newest, time);
+  }
+  if (modificationTime(output) >= newest)
+    return 0; // up to date
+
+  cout << "packing " << output << endl;
+
+  ofstream out(output, ios::binary);
+  if (!out.good()) {
+    cerr << "cannot write " << output << endl;
+    return 1;
+  }
+
+  // a partial pack would be newer than its inputs
+  auto fail = [&] {
+    out.close();
+    remove(output.c_str());
+    return 1;
+  };
+  auto pad = [&] {
+    static const char zeros[pack::ALIGNMENT] = {};
+    auto pos = (uint64_t)out.tellp();
+    out.write(zeros, (pack::ALIGNMENT - pos % pack::ALIGNMENT) % pack::ALIGNMENT);
+  };
+
+  pack::Header header = {};
+  memcpy(header.magic, pack::MAGIC, sizeof(header.magic));
+  header.version = pack::VERSION;
+  out.write((char const *)&header, sizeof(header));
+
+  // payloads, one at a time, identical ones once
+  vector<Input> inputs;
+  string names;
+  map<pair<uint64_t, uint64_t>, vector<uint64_t>> stored; // (content hash, size) -> offsets
+  uint64_t total = 0, deduplicated = 0;
+  for (auto const &path : paths) {
+    ifstream in(dir + path, ios::binary | ios::ate);
+    vector<char> data((size_t)max<streamoff>(0, in.tellg()));
+    in.seekg(0);
+    if (!in.read(data.data(), data.size())) {
+      cerr << "cannot read " << dir + path << endl;
+      return fail();
+    }
+
+    Input i = {path, {}};
+    i.entry.pathHash = pack::hash(path.data(), path.size());
+    i.entry.contentHash = pack::hash(data.data(), data.size());
+    i.entry.size = data.size();
+    i.entry.nameOffset = (uint32_t)names.size();
+    i.entry.nameSize = (uint32_t)path.size();
+    names += path;
+    total += data.size();
+
+    // same hash and size is compared byte by byte against what was written before
+    auto &candidates = stored[{i.entry.contentHash, i.entry.size}];
+    auto found = find_if(candidates.begin(), candidates.end(), [&](uint64_t offset) {
+      ifstream check(output, ios::binary);
+      check.seekg(offset);
+      vector<char> other(data.size());
+      check.read(other.data(), other.size());
+      return other == data;
+    });
+    if (found != candidates.end()) {
+      i.entry.offset = *found;
+      deduplicated += data.size();
+    } else {
+      pad();
+      i.entry.offset = (uint64_t)out.tellp();
+      out.write(data.data(), data.size());
+      out.flush(); // readable for later comparisons
+      candidates.push_back(i.entry.offset);
+    }
+    inputs.push_back(i);
+  }
+
+  // index sorted by path hash, for binary search at runtime
+  sort(inputs.begin(), inputs.end(), [](Input const &a, Input const &b) { return a.entry.pathHash < b.entry.pathHash; });
+  for (size_t i = 1; i < inputs.size(); i++)
+    if (inputs[i].entry.pathHash == inputs[i - 1].entry.pathHash) {
+      cerr << "path hash collision: " << inputs[i - 1].path << ", " << inputs[i].path << endl;
+      return fail();
+    }
+
+  pad();
+  header.count = (uint32_t)inputs.size();
+  header.entriesOffset = (uint64_t)out.tellp();
+  for (auto const &i : inputs)
+    out.write((char const *)&i.entry, sizeof(i.entry));
+  header.namesOffset = (uint64_t)out.tellp();
+  header.namesSize = names.size();
+  out.write(names.data(), names.size());
+
+  out.seekp(0);
+  out.write((char const *)&header, sizeof(header));
+  if (!out.good()) {
+    cerr << "cannot write " << output << endl;
+    return fail();
+  }
+
+  cout << inputs.size() << " files, " << total / 1024 << " KiB, " << deduplicated / 1024 << " KiB deduplicated" << endl;
+  return 0;
+}